@@ -1,5 +1,6 @@
 #include "shape.h"
 #include "_abCircle.h"
+#include "vec2inline.h"
 
 // true if pixel is in circle centered at centerPos
 int abCircleCheck(const AbCircle *circle, const Vec2 *centerPos, const Vec2 *pixel)
@@ -7,8 +8,8 @@ int abCircleCheck(const AbCircle *circle, const Vec2 *centerPos, const Vec2 *pix
   u_char radius = circle->radius;
   int axis;
   Vec2 relPos;
-  vec2Sub(&relPos, pixel, centerPos); /* vector from center to pixel */
-  vec2Abs(&relPos);		      /* project to first quadrant */
+  vec2SubInline(&relPos, pixel, centerPos); /* vector from center to pixel */
+  vec2AbsInline(&relPos);		    /* project to first quadrant */
   return (relPos.axes[0] <= radius && circle->chords[relPos.axes[0]] >= relPos.axes[1]);
 }
   
@@ -23,3 +24,26 @@ abCircleGetBounds(const AbCircle *circle, const Vec2 *centerPos, Region *bounds)
   regionClipScreen(bounds);
 }
 
+
+// Span function (see AbSpanClass in shape.h)
+// A pixel is within the circle when chords[|col offset|] >= |row offset|;
+// chords never increase, so binary search for the widest such offset.
+int
+abCircleGetSpans(const AbCircle *circle, const Vec2 *centerPos, int row, Span *spans)
+{
+  int relRow = row - centerPos->axes[1];
+  int lo = 0, hi = circle->radius;
+  relRow = (relRow >= 0) ? relRow : -relRow;
+  if (relRow > circle->radius || circle->chords[0] < relRow)
+    return 0;
+  while (lo < hi) {		/* chords[lo] >= relRow always */
+    int mid = (lo + hi + 1) >> 1;
+    if (circle->chords[mid] >= relRow)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  spans->colMin = centerPos->axes[0] - lo;
+  spans->colMax = centerPos->axes[0] + lo;
+  return 1;
+}
@@ -59,6 +59,33 @@ void drawString8x12(u_char col, u_char row, char *string,
 void drawChar5x7(u_char col, u_char row, char c, 
 		 u_int fgColorBGR, u_int bgColorBGR);
 
+/** Draw character at col,row in a (possibly subsetted) 5x7 font
+ *
+ *  \param col Column to draw character
+ *  \param row Row to draw character
+ *  \param c The character
+ *  \param font The font, e.g. &font5x7 or one made by makeFontSubset
+ *  \param fgColorBGR Foreground color in BGR
+ *  \param bgColorBGR Background color in BGR
+ */
+void drawCharFont5x7(u_char col, u_char row, char c, const Font5x7 *font,
+		     u_int fgColorBGR, u_int bgColorBGR);
+
+/** As drawString5x7, but in the specified font
+ */
+void drawStringFont5x7(u_char col, u_char row, char *string, const Font5x7 *font,
+		       u_int fgColorBGR, u_int bgColorBGR);
+
+/** As drawCharFont5x7, for 8x12 fonts
+ */
+void drawCharFont8x12(u_char col, u_char row, char c, const Font8x12 *font,
+		      u_int fgColorBGR, u_int bgColorBGR);
+
+/** As drawString8x12, but in the specified font
+ */
+void drawStringFont8x12(u_char col, u_char row, char *string, const Font8x12 *font,
+			u_int fgColorBGR, u_int bgColorBGR);
+
 /** Draw rectangle outline
  *  
  *  \param colMin Column start
@@ -69,6 +96,104 @@ void drawChar5x7(u_char col, u_char row, char c,
  */
 void drawRectOutline(u_char colMin, u_char rowMin, u_char width, u_char height,
 		     u_int colorBGR);
+/** Fill convex polygon, one run per row
+ *
+ *  Edges are walked with an integer DDA, so no multiplies or divides
+ *  are done per row.
+ *
+ *  \param verts Array of {col, row} pairs in order around the perimeter
+ *  \param numVerts Number of vertices (at least 3)
+ *  \param colorBGR Color of polygon in BGR
+ */
+void fillConvexPolygon(const u_char verts[][2], u_char numVerts, u_int colorBGR);
+
+/** Fill triangle
+ *
+ *  \param col0, row0, col1, row1, col2, row2 The three corners
+ *  \param colorBGR Color of triangle in BGR
+ */
+void fillTriangle(u_char col0, u_char row0, u_char col1, u_char row1,
+		  u_char col2, u_char row2, u_int colorBGR);
+
+/** One run of a repeating pattern: len pixels of colorBGR */
+typedef struct {
+  u_int colorBGR;
+  u_char len;
+} PatternRun;
+
+/** Rows of a pattern: runs repeat across each row for height rows */
+typedef struct {
+  const PatternRun *runs;
+  u_char numRuns;
+  u_char height;
+} PatternBand;
+
+/** A pattern that repeats in both directions.
+ *  Bands are stacked top to bottom and then repeat.
+ *  e.g. a checkerboard has two bands whose runs are {white,8},{black,8}
+ *  and {black,8},{white,8}, each 8 rows high.
+ */
+typedef struct {
+  const PatternBand *bands;
+  u_char numBands;
+} Pattern;
+
+/** Fill rectangle with a repeating pattern, one run at a time
+ *
+ *  The pattern's origin is at (colMin - colPhase, rowMin - rowPhase),
+ *  so scrolling a pattern only requires changing a phase.  Nothing is
+ *  drawn if the pattern can't be (see patternHeight).
+ *
+ *  \param colMin Column start
+ *  \param rowMin Row start
+ *  \param width Width of rectangle
+ *  \param height Height of rectangle
+ *  \param pattern The pattern
+ *  \param colPhase Horizontal offset into the pattern
+ *  \param rowPhase Vertical offset into the pattern
+ */
+void fillPattern(u_char colMin, u_char rowMin, u_char width, u_char height,
+		 const Pattern *pattern, u_int colPhase, u_int rowPhase);
+
+/** pos modulo period, without dividing (the MSP430 has no divider).
+ *  Costs nothing when pos is already below period.
+ *
+ *  \param period Must not be 0
+ */
+u_int patternWrap(u_int pos, u_int period);
+
+/** Locate position pos (modulo the pattern's period) within a band
+ *
+ *  \param band The band
+ *  \param pos Column within the band's (repeating) runs
+ *  \param runLeft (out) pixels remaining in that run, 0 if the band
+ *         has no pixels
+ *  \return Index of the run containing pos
+ */
+u_char patternBandFind(const PatternBand *band, u_int pos, u_char *runLeft);
+
+/** Locate row (modulo the pattern's height) within a pattern
+ *
+ *  \param rowsLeft (out) rows remaining in that band, 0 if the
+ *         pattern has no rows
+ *  \return Index of the band containing row
+ */
+u_char patternFindBand(const Pattern *pattern, u_int row, u_char *rowsLeft);
+
+/** Rows before a pattern repeats
+ *
+ *  \return 0 if the pattern can't be drawn: it has no bands, or a band
+ *          with no rows, no runs or a run of no pixels
+ */
+u_int patternHeight(const Pattern *pattern);
+
+/** Columns before every band of a pattern repeats
+ *
+ *  \return 0 if the pattern can't be drawn (see patternHeight) or
+ *          repeats only after more than 32767 columns
+ */
+u_int patternWidth(const Pattern *pattern);
+
 #endif // included
 
 
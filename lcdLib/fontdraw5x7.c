@@ -0,0 +1,20 @@
+#include "lcdutils.h"
+#include "lcddraw.h"
+
+/* The complete font's descriptor and draw functions are kept out of
+ * lcddraw.o so that programs drawing only subsetted fonts don't link
+ * font_5x7.
+ */
+const Font5x7 font5x7 = {font_5x7, 0};
+
+void drawChar5x7(u_char col, u_char row, char c,
+		 u_int fgColorBGR, u_int bgColorBGR)
+{
+  drawCharFont5x7(col, row, c, &font5x7, fgColorBGR, bgColorBGR);
+}
+
+void drawString5x7(u_char col, u_char row, char *string,
+		   u_int fgColorBGR, u_int bgColorBGR)
+{
+  drawStringFont5x7(col, row, string, &font5x7, fgColorBGR, bgColorBGR);
+}
@@ -0,0 +1,20 @@
+#include "lcdutils.h"
+#include "lcddraw.h"
+
+/* The complete font's descriptor and draw functions are kept out of
+ * lcddraw.o so that programs drawing only subsetted fonts don't link
+ * font_8x12.
+ */
+const Font8x12 font8x12 = {font_8x12, 0};
+
+void drawChar8x12(u_char col, u_char row, char c,
+		  u_int fgColorBGR, u_int bgColorBGR)
+{
+  drawCharFont8x12(col, row, c, &font8x12, fgColorBGR, bgColorBGR);
+}
+
+void drawString8x12(u_char col, u_char row, char *string,
+		    u_int fgColorBGR, u_int bgColorBGR)
+{
+  drawStringFont8x12(col, row, string, &font8x12, fgColorBGR, bgColorBGR);
+}
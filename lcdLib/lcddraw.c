@@ -50,19 +50,23 @@ void clearScreen(u_int colorBGR)
 
 /** 5x7 font - this function draws background pixels
  *  Adapted from RobG's EduKit
+ *
+ *  font may be a subset produced by makeFontSubset; its map costs
+ *  one byte load per glyph.
  */
-void drawChar5x7(u_char rcol, u_char rrow, char c, 
+void drawCharFont5x7(u_char rcol, u_char rrow, char c, const Font5x7 *font,
      u_int fgColorBGR, u_int bgColorBGR) 
 {
   u_char col = 0;
   u_char row = 0;
   u_char bit = 0x01;
   u_char oc = c - 0x20;
+  const unsigned char *glyph = font->glyphs[font->map ? font->map[oc] : oc];
 
   lcd_setArea(rcol, rrow, rcol + 4, rrow + 7); /* relative to requested col/row */
   while (row < 8) {
     while (col < 5) {
-      u_int colorBGR = (font_5x7[oc][col] & bit) ? fgColorBGR : bgColorBGR;
+      u_int colorBGR = (glyph[col] & bit) ? fgColorBGR : bgColorBGR;
       lcd_writeColor(colorBGR);
       col++;
     }
@@ -72,21 +76,22 @@ void drawChar5x7(u_char rcol, u_char rrow, char c,
   }
 }
 
-/** 5x7 font - this function draws background pixels
+/** 8x12 font - this function draws background pixels
  *  Adapted from RobG's EduKit
  */
-void drawChar8x12(u_char rcol, u_char rrow, char c, 
+void drawCharFont8x12(u_char rcol, u_char rrow, char c, const Font8x12 *font,
      u_int fgColorBGR, u_int bgColorBGR) 
 {
   u_char col = 0;
   u_char row = 0;
   u_char bit = 0x01;
   u_char oc = c - 0x20;
+  const unsigned char *glyph = font->glyphs[font->map ? font->map[oc] : oc];
 
   lcd_setArea(rcol, rrow, rcol + 7, rrow + 12); /* relative to requested col/row */
   while (row < 13) {
     while (col < 8) {
-      u_int colorBGR = (font_8x12[oc][col] & bit) ? fgColorBGR : bgColorBGR;
+      u_int colorBGR = (glyph[col] & bit) ? fgColorBGR : bgColorBGR;
       lcd_writeColor(colorBGR);
       col++;
     }
@@ -96,34 +101,30 @@ void drawChar8x12(u_char rcol, u_char rrow, char c,
   }
 }
 
-  
-/** Draw string at col,row
- *  Type:
- *  FONT_SM - small (5x8,) FONT_MD - medium (8x12,) FONT_LG - large (11x16)
- *  FONT_SM_BKG, FONT_MD_BKG, FONT_LG_BKG - as above, but with background color
- *  Adapted from RobG's EduKit
+/** Draw string at col,row using a (possibly subsetted) 5x7 font
  *
  *  \param col Column to start drawing string
  *  \param row Row to start drawing string
  *  \param string The string
+ *  \param font The font
  *  \param fgColorBGR Foreground color in BGR
  *  \param bgColorBGR Background color in BGR
  */
-void drawString5x7(u_char col, u_char row, char *string,
+void drawStringFont5x7(u_char col, u_char row, char *string, const Font5x7 *font,
 		u_int fgColorBGR, u_int bgColorBGR)
 {
   u_char cols = col;
   while (*string) {
-    drawChar5x7(cols, row, *string++, fgColorBGR, bgColorBGR);
+    drawCharFont5x7(cols, row, *string++, font, fgColorBGR, bgColorBGR);
     cols += 5;
   }
 }
 
-void drawString8x12(u_char col, u_char row, char *string,
+void drawStringFont8x12(u_char col, u_char row, char *string, const Font8x12 *font,
 		u_int fgColorBGR, u_int bgColorBGR){
   u_char cols = col;
   while (*string) {
-    drawChar8x12(cols, row, *string++, fgColorBGR, bgColorBGR);
+    drawCharFont8x12(cols, row, *string++, font, fgColorBGR, bgColorBGR);
     cols += 11;
   }
 }
@@ -148,3 +149,240 @@ void drawRectOutline(u_char colMin, u_char rowMin, u_char width, u_char height,
   fillRectangle(colMin + width, rowMin, 1, height, colorBGR);
 }
 
+
+/** Edge of a polygon being walked one row at a time (integer DDA).
+ *  col advances by step each row, plus one more whenever the
+ *  accumulated remainder err reaches dRow.
+ */
+typedef struct {
+  int col, step, rem, err, dRow;
+  u_char rowEnd;
+} Edge;
+
+/** Prepare edge to walk from (c0,r0) down to (c1,r1).  r1 >= r0 */
+static void edgeInit(Edge *e, u_char c0, u_char r0, u_char c1, u_char r1)
+{
+  int dCol = (int)c1 - c0, dRow = (int)r1 - r0;
+  e->err = 0; e->rowEnd = r1;
+  if (!dRow) {			/* horizontal: land on its far end */
+    e->col = c1; e->step = e->rem = 0; e->dRow = 1;
+    return;
+  }
+  e->col = c0; e->dRow = dRow;
+  e->step = dCol / dRow;	/* floor(dCol/dRow): the only divides */
+  e->rem = dCol % dRow;
+  if (e->rem < 0) {
+    e->step--;
+    e->rem += dRow;
+  }
+}
+
+/** Advance edge by one row (adds & compares only) */
+static inline void edgeStep(Edge *e)
+{
+  e->col += e->step;
+  e->err += e->rem;
+  if (e->err >= e->dRow) {
+    e->col++;
+    e->err -= e->dRow;
+  }
+}
+
+/** Move a chain of edges onto the edge that spans row.
+ *  dir is +1 or -1; a chain stops once it reaches the bottom row.
+ */
+static void chainAdvance(Edge *e, u_char *cur, char dir, u_char row,
+			 const u_char verts[][2], u_char numVerts, u_char rowBot)
+{
+  while (e->rowEnd <= row && verts[*cur][1] < rowBot) {
+    u_char next = *cur + dir;
+    if (dir < 0 && *cur == 0) next = numVerts - 1;
+    else if (next == numVerts) next = 0;
+    edgeInit(e, verts[*cur][0], verts[*cur][1], verts[next][0], verts[next][1]);
+    *cur = next;
+  }
+}
+
+/** Fill convex polygon
+ *
+ *  Vertices must be listed in order around the perimeter (either
+ *  direction).  Each row is emitted as a single run between the two
+ *  edge chains that descend from the top vertex.
+ *
+ *  \param verts Array of numVerts {col, row} pairs
+ *  \param numVerts Number of vertices (at least 3)
+ *  \param colorBGR Color of polygon in BGR
+ */
+void fillConvexPolygon(const u_char verts[][2], u_char numVerts, u_int colorBGR)
+{
+  u_char i, top = 0, rowBot, row;
+  u_char curA, curB;		/* vertex at the lower end of each chain's edge */
+  Edge a, b;
+
+  rowBot = verts[0][1];
+  for (i = 1; i < numVerts; i++) {
+    if (verts[i][1] < verts[top][1]) top = i;
+    if (verts[i][1] > rowBot) rowBot = verts[i][1];
+  }
+  curA = curB = top;
+  edgeInit(&a, verts[top][0], verts[top][1], verts[top][0], verts[top][1]);
+  b = a;
+  if (rowBot == verts[top][1])	/* flat: chains never leave the top */
+    for (i = 0; i < numVerts; i++) {
+      if (verts[i][0] < a.col) a.col = verts[i][0];
+      if (verts[i][0] > b.col) b.col = verts[i][0];
+    }
+  for (row = verts[top][1]; ; row++) {
+    chainAdvance(&a, &curA, 1, row, verts, numVerts, rowBot);
+    chainAdvance(&b, &curB, -1, row, verts, numVerts, rowBot);
+    {
+      u_char colMin = a.col < b.col ? a.col : b.col;
+      u_char colMax = a.col < b.col ? b.col : a.col;
+      u_char c = colMax - colMin + 1;
+      lcd_setArea(colMin, row, colMax, row);
+      while (c--)
+	lcd_writeColor(colorBGR);
+    }
+    if (row == rowBot)
+      break;
+    edgeStep(&a);
+    edgeStep(&b);
+  }
+}
+
+/** Fill triangle
+ *
+ *  \param col0, row0, col1, row1, col2, row2 The three corners
+ *  \param colorBGR Color of triangle in BGR
+ */
+void fillTriangle(u_char col0, u_char row0, u_char col1, u_char row1,
+		  u_char col2, u_char row2, u_int colorBGR)
+{
+  const u_char verts[3][2] = {{col0, row0}, {col1, row1}, {col2, row2}};
+  fillConvexPolygon(verts, 3, colorBGR);
+}
+
+u_int patternWrap(u_int pos, u_int period)
+{
+  u_int d = period;
+  if (pos < period)		/* the usual case: no work */
+    return pos;
+  while (d <= (pos >> 1))	/* largest period << k not above pos */
+    d <<= 1;
+  while (pos >= period) {	/* shift & subtract: no divides */
+    if (pos >= d)
+      pos -= d;
+    d >>= 1;
+  }
+  return pos;
+}
+
+u_char patternBandFind(const PatternBand *band, u_int pos, u_char *runLeft)
+{
+  u_int period = 0;
+  u_char i;
+  for (i = 0; i < band->numRuns; i++)
+    period += band->runs[i].len;
+  if (!period) {		/* nothing to find */
+    *runLeft = 0;
+    return 0;
+  }
+  pos = patternWrap(pos, period);
+  for (i = 0; pos >= band->runs[i].len; i++)
+    pos -= band->runs[i].len;
+  *runLeft = band->runs[i].len - pos;
+  return i;
+}
+
+u_char patternFindBand(const Pattern *pattern, u_int row, u_char *rowsLeft)
+{
+  u_int period = 0;
+  u_char i;
+  for (i = 0; i < pattern->numBands; i++)
+    period += pattern->bands[i].height;
+  if (!period) {		/* nothing to find */
+    *rowsLeft = 0;
+    return 0;
+  }
+  row = patternWrap(row, period);
+  for (i = 0; row >= pattern->bands[i].height; i++)
+    row -= pattern->bands[i].height;
+  *rowsLeft = pattern->bands[i].height - row;
+  return i;
+}
+
+u_int patternHeight(const Pattern *pattern)
+{
+  u_int height = 0;
+  u_char i, j;
+  for (i = 0; i < pattern->numBands; i++) {
+    const PatternBand *band = &pattern->bands[i];
+    if (!band->height || !band->numRuns)
+      return 0;
+    for (j = 0; j < band->numRuns; j++)
+      if (!band->runs[j].len)
+	return 0;
+    height += band->height;
+  }
+  return height;
+}
+
+u_int patternWidth(const Pattern *pattern)
+{
+  u_int width = 0;
+  u_char i, j;
+  if (!patternHeight(pattern))
+    return 0;
+  for (i = 0; i < pattern->numBands; i++) {
+    u_int period = 0, multiple;
+    for (j = 0; j < pattern->bands[i].numRuns; j++)
+      period += pattern->bands[i].runs[j].len;
+    if (!width) {
+      width = period;
+      continue;
+    }
+    for (multiple = width; patternWrap(multiple, period); multiple += width)
+      if (multiple > 0x7fff - width)
+	return 0;		/* too wide */
+    width = multiple;
+  }
+  return width;
+}
+
+/** Fill rectangle with a repeating pattern
+ *  The pattern's position is located once; after that each row only
+ *  steps through runs, writing each as a burst of one color.
+ */
+void fillPattern(u_char colMin, u_char rowMin, u_char width, u_char height,
+		 const Pattern *pattern, u_int colPhase, u_int rowPhase)
+{
+  u_char rowsLeft, bandIndex, startRun, startLeft;
+  const PatternBand *band;
+
+  if (!width || !height || !patternHeight(pattern))
+    return;			/* nothing to draw, or no pattern to draw it with */
+  lcd_setArea(colMin, rowMin, colMin + width - 1, rowMin + height - 1);
+  bandIndex = patternFindBand(pattern, rowPhase, &rowsLeft);
+  band = &pattern->bands[bandIndex];
+  startRun = patternBandFind(band, colPhase, &startLeft);
+  while (height--) {
+    u_char col = width, run = startRun, left = startLeft;
+    while (col) {
+      u_int colorBGR = band->runs[run].colorBGR;
+      u_char n = left < col ? left : col;
+      col -= n;
+      while (n--)
+	lcd_writeColor(colorBGR);
+      if (++run == band->numRuns)
+	run = 0;
+      left = band->runs[run].len;
+    }
+    if (!--rowsLeft) {		/* next band */
+      if (++bandIndex == pattern->numBands)
+	bandIndex = 0;
+      band = &pattern->bands[bandIndex];
+      rowsLeft = band->height;
+      startRun = patternBandFind(band, colPhase, &startLeft);
+    }
+  }
+}
@@ -99,6 +99,19 @@ void lcd_writeColor(u_int colorBGR)
   lcd_writeData(colorU.colorBytes[0]);
 }
 
+void lcd_writeColors(const u_int *colorsBGR, u_int count)
+{
+  while (UCB0STAT & UCBUSY);	/**< wait for previous transfer to complete */
+  LCD_DC_HI();			/**< everything that follows is data */
+  while (count--) {
+    u_int colorBGR = *colorsBGR++;
+    while (!(IFG2 & UCB0TXIFG));	/**< queue each byte as soon as there's room */
+    UCB0TXBUF = colorBGR >> 8;
+    while (!(IFG2 & UCB0TXIFG));
+    UCB0TXBUF = colorBGR;
+  }
+}
+
 /** Write command to LCD (private) */
 void _writeCommand(u_char command) 
 {
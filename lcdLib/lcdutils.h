@@ -14,6 +14,25 @@ extern const unsigned char font_5x7[96][5];
 extern const unsigned char font_8x12[95][12];
 extern const unsigned int font_11x16[95][11];
 
+/** A font, or a subset of one generated by makeFontSubset
+ *
+ *  glyphs: glyph bitmaps
+ *  map: index into glyphs of each character code - 0x20, or 0 when
+ *  glyphs holds every character in code order.
+ */
+typedef struct {
+  const unsigned char (*glyphs)[5];
+  const unsigned char *map;
+} Font5x7;
+
+typedef struct {
+  const unsigned char (*glyphs)[12];
+  const unsigned char *map;
+} Font8x12;
+
+extern const Font5x7 font5x7;	/* complete fonts */
+extern const Font8x12 font8x12;
+
 extern const unsigned int colors[43];
 
 
@@ -56,6 +75,16 @@ void lcd_setArea(u_char colStart, u_char rowStart, u_char colEnd, u_char rowEnd)
  */
 void lcd_writeColor(u_int colorBGR);
 
+/** Write count colors to LCD in one burst
+ *
+ *  Sets data mode once, then feeds the SPI transmit buffer as soon as
+ *  it empties, rather than waiting for each transfer to finish.
+ *
+ *  \param colorsBGR The colors in BGR
+ *  \param count Number of colors
+ */
+void lcd_writeColors(const u_int *colorsBGR, u_int count);
+
 #define rgb2bgr(val) ((((val) << 11)&0xf800) | ((val)&0x7e0) | (((val)>>11)&0x1f))
 
 /** Colors */
@@ -0,0 +1,156 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "assert.h"
+#include "lcdutils.h"
+
+// Generate a font containing only the characters a program draws.
+//
+// usage: makeFontSubset [-f 5x7|8x12] [-n name] [-c chars] [source.c ...]
+//
+// Characters are collected from the string and character literals of
+// each source file plus any listed with -c (use -c for characters
+// that are computed, such as '0' + digit).  name.c and name.h are
+// written to the current directory; name.c defines "const Font5x7 name"
+// (or Font8x12) for use with drawStringFont5x7 (or drawStringFont8x12).
+
+#define NUM_CODES 96		/* character codes 0x20 - 0x7f */
+
+char used[NUM_CODES];
+
+void useChar(int c)
+{
+  if (c >= 0x20 && c < 0x20 + NUM_CODES)
+    used[c - 0x20] = 1;
+}
+
+// read one (possibly escaped) character from within a literal
+int readLiteralChar(FILE *fp, int c)
+{
+  if (c != '\\')
+    return c;
+  c = getc(fp);
+  switch (c) {
+  case 'n': return '\n';
+  case 't': return '\t';
+  case 'x': {
+    int val = 0, d;
+    while ((d = getc(fp)) != EOF && strchr("0123456789abcdefABCDEF", d))
+      val = val * 16 + (d <= '9' ? d - '0' : (d | 0x20) - 'a' + 10);
+    ungetc(d, fp);
+    return val;
+  }
+  default:
+    if (c >= '0' && c <= '7') {	/* octal */
+      int val = c - '0', n, d;
+      for (n = 1; n < 3 && (d = getc(fp)) >= '0' && d <= '7'; n++)
+	val = val * 8 + d - '0';
+      if (n < 3) ungetc(d, fp);
+      return val;
+    }
+    return c;			/* \\ \" \' etc */
+  }
+}
+
+// collect characters from the literals in a C source file
+void scanSource(const char *filename)
+{
+  FILE *fp = fopen(filename, "r");
+  int c, prev = '\n';
+  if (!fp) {
+    fprintf(stderr, "makeFontSubset: can't read %s\n", filename);
+    exit(1);
+  }
+  while ((c = getc(fp)) != EOF) {
+    if (prev == '\n' && c == '#') {		/* skip #include "file.h" etc */
+      while ((c = getc(fp)) != EOF && c != '\n')
+	;
+    } else if (prev == '/' && c == '/') {	/* line comment */
+      while ((c = getc(fp)) != EOF && c != '\n')
+	;
+    } else if (prev == '/' && c == '*') {	/* block comment */
+      int last = 0;
+      while ((c = getc(fp)) != EOF && !(last == '*' && c == '/'))
+	last = c;
+      c = 0;
+    } else if (c == '"' || c == '\'') {	/* literal */
+      int quote = c;
+      while ((c = getc(fp)) != EOF && c != quote && c != '\n')
+	useChar(readLiteralChar(fp, c));
+      c = 0;
+    }
+    prev = c;
+  }
+  fclose(fp);
+}
+
+int main(int argc, char **argv)
+{
+  const char *fontName = "5x7", *name = "fontSubset";
+  const unsigned char *glyphs;
+  int glyphBytes, numGlyphs, code, i, argi;
+  unsigned char map[NUM_CODES];
+  char filename[100];
+  FILE *fp;
+
+  for (argi = 1; argi < argc; argi++) {
+    if (!strcmp(argv[argi], "-f") && argi + 1 < argc)
+      fontName = argv[++argi];
+    else if (!strcmp(argv[argi], "-n") && argi + 1 < argc)
+      name = argv[++argi];
+    else if (!strcmp(argv[argi], "-c") && argi + 1 < argc) {
+      const char *s;
+      for (s = argv[++argi]; *s; s++)
+	useChar(*s);
+    } else
+      scanSource(argv[argi]);
+  }
+
+  if (!strcmp(fontName, "5x7")) {
+    glyphs = &font_5x7[0][0]; glyphBytes = 5; numGlyphs = 96;
+  } else if (!strcmp(fontName, "8x12")) {
+    glyphs = &font_8x12[0][0]; glyphBytes = 12; numGlyphs = 95;
+  } else {
+    fprintf(stderr, "makeFontSubset: unknown font %s\n", fontName);
+    exit(1);
+  }
+
+  used[0] = 1;			/* space is glyph 0; unused codes map to it */
+  memset(map, 0, sizeof(map));
+
+  sprintf(filename, "%s.c", name);
+  fp = fopen(filename, "w");
+  assert(fp);
+  fprintf(fp, "// Automatically generated by makeFontSubset.\n");
+  fprintf(fp, "#include \"lcdutils.h\"\n");
+  fprintf(fp, "#include \"%s.h\"\n\n", name);
+  fprintf(fp, "static const unsigned char glyphs[][%d] = {\n", glyphBytes);
+  for (code = 0, i = 0; code < numGlyphs; code++) {
+    int b;
+    if (!used[code])
+      continue;
+    map[code] = i++;
+    fprintf(fp, "  {");
+    for (b = 0; b < glyphBytes; b++)
+      fprintf(fp, "%s0x%02x", b ? ", " : " ", glyphs[code * glyphBytes + b]);
+    fprintf(fp, " }, // %02x %c\n", code + 0x20,
+	    code + 0x20 == '\\' ? ' ' : code + 0x20); /* no line splice */
+  }
+  fprintf(fp, "};\n\n");
+  fprintf(fp, "static const unsigned char map[%d] = {", NUM_CODES);
+  for (code = 0; code < NUM_CODES; code++)
+    fprintf(fp, "%s%d,", (code % 16) ? " " : "\n  ", map[code]);
+  fprintf(fp, "\n};\n\n");
+  fprintf(fp, "const Font%s %s = {glyphs, map};\n", fontName, name);
+  fclose(fp);
+
+  sprintf(filename, "%s.h", name);
+  fp = fopen(filename, "w");
+  assert(fp);
+  fprintf(fp, "// Automatically generated by makeFontSubset.\n");
+  fprintf(fp, "#ifndef %s_included\n#define %s_included\n\n", name, name);
+  fprintf(fp, "extern const Font%s %s;\t/* %d of %d glyphs */\n", fontName, name, i, numGlyphs);
+  fprintf(fp, "\n#endif // included \n");
+  fclose(fp);
+  return 0;
+}
@@ -27,7 +27,7 @@
 #define C6 955
 
 //Array that contains the notes of the testris song
-int game_song[] = {F4,  0,  0, D4,  0,  0, D4,  0, C4,  0,
+const int game_song[] = {F4,  0,  0, D4,  0,  0, D4,  0, C4,  0,
 		    0, D4,  0,  0, D4,  0, F4,  0,  0, D4,
 		    0,  0, D4,  0, C4, C4, D4, D4, F4,  0,
 		   G4,  0,  0, F4,  0,  0, A4,  0, G4,  0,
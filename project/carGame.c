@@ -6,8 +6,13 @@
 #include <shape.h>
 #include <abCircle.h>
 #include "buzzer.h"
+#include "fontGame.h"
+#include "carBitmap.h"		/* generated from car.pbm */
 
 #define GREEN_LED BIT6
+#define MSG_NONE 0
+#define MSG_TITLE 1
+#define MSG_GAME_OVER 2
 #define SW1 BIT0
 #define SW2 BIT1
 #define SW3 BIT2
@@ -19,31 +24,19 @@ int carVerOffset = 0;
 /** 
    Initialize the shape
 */
-AbRect carBody = {abRectGetBounds, abRectCheck, {8 ,10}}; // car body - rectangle 
-AbRect grass = {abRectGetBounds, abRectCheck, {13, screenHeight/2}}; // grass in both sides of the road - rectangle
-AbRect enemy = {abRectGetBounds, abRectCheck, {10,10}}; // enemies - circle
-AbRectOutline fieldOutline = { abRectOutlineGetBounds, abRectOutlineCheck, {screenWidth/2, screenHeight/2 + 20} }; // playing field
+const AbRect grass = {abRectGetBounds, abRectCheck, {13, screenHeight/2}}; // grass in both sides of the road - rectangle
+const AbRectOutline fieldOutline = { abRectOutlineGetBounds, abRectOutlineCheck, {screenWidth/2, screenHeight/2 + 20} }; // playing field
 
 /** 
    Initialize the layers
 */
-Layer fieldLayer = { (AbShape *) &fieldOutline, {screenWidth/2, screenHeight/2 - 20}, {0,0}, {0,0}, COLOR_BLACK, 0 }; 
-Layer grassRightSide = { (AbShape *)&grass, {0, (screenHeight/2)}, {0,0}, {0,0}, COLOR_GREEN, &fieldLayer };
-Layer grassLeftSide = { (AbShape *)&grass, {(screenWidth), (screenHeight/2)}, {0,0}, {0,0}, COLOR_GREEN, &grassRightSide };
-Layer car = { (AbShape *)&carBody, {screenWidth/2, screenHeight/2}, {0,0}, {0,0}, COLOR_BLUE, &grassLeftSide };
-Layer enemyLeftSide = { (AbShape *)&circle4, {screenWidth/2 - 30, -13}, {0,0}, {0,0}, COLOR_YELLOW, &car };
-Layer enemyRightSide = { (AbShape *)&circle4, {screenWidth/2 + 30, -13}, {0,0}, {0,0}, COLOR_YELLOW, &enemyLeftSide };
-Layer enemyCenter = { (AbShape *)&circle4, {screenWidth/2, -13}, {0,0}, {0,0}, COLOR_YELLOW, &enemyRightSide };
-
-/** Moving Layer
- *  Linked list of layer references
- *  Velocity represents one iteration of change (direction & magnitude)
- */
-typedef struct MovLayer_s {
-  Layer *layer;
-  Vec2 velocity;
-  struct MovLayer_s *next;
-} MovLayer;
+Layer fieldLayer = { (AbShape *) &fieldOutline, LAYER_POS(screenWidth/2, screenHeight/2 - 20), LAYER_POS(0,0), LAYER_POS(0,0), COLOR_BLACK, 0 }; 
+Layer grassRightSide = { (AbShape *)&grass, LAYER_POS(0, (screenHeight/2)), LAYER_POS(0,0), LAYER_POS(0,0), COLOR_GREEN, &fieldLayer };
+Layer grassLeftSide = { (AbShape *)&grass, LAYER_POS((screenWidth), (screenHeight/2)), LAYER_POS(0,0), LAYER_POS(0,0), COLOR_GREEN, &grassRightSide };
+Layer car = { (AbShape *)&carBitmap, LAYER_POS(screenWidth/2, screenHeight/2), LAYER_POS(0,0), LAYER_POS(0,0), COLOR_BLUE, &grassLeftSide };
+Layer enemyLeftSide = { (AbShape *)&circle4, LAYER_POS(screenWidth/2 - 30, -13), LAYER_POS(0,0), LAYER_POS(0,0), COLOR_YELLOW, &car };
+Layer enemyRightSide = { (AbShape *)&circle4, LAYER_POS(screenWidth/2 + 30, -13), LAYER_POS(0,0), LAYER_POS(0,0), COLOR_YELLOW, &enemyLeftSide };
+Layer enemyCenter = { (AbShape *)&circle4, LAYER_POS(screenWidth/2, -13), LAYER_POS(0,0), LAYER_POS(0,0), COLOR_YELLOW, &enemyRightSide };
 
 /** Car Moving Layer Linked List
  */
@@ -51,62 +44,34 @@ MovLayer ml0 = { &car, {0,0}, 0 };
 
 /** Enemy Moving Layer Linked List
  */
-MovLayer enemyMl2 = { &enemyLeftSide, {0,5}, 0};
-MovLayer enemyMl1 = { &enemyRightSide, {0,4}, &enemyMl2};
-MovLayer enemyMl0 = { &enemyCenter, {0,7}, &enemyMl1};
+MovLayer enemyMl2 = { &enemyLeftSide, {0,FIX(5)}, 0};
+MovLayer enemyMl1 = { &enemyRightSide, {0,FIX(4)}, &enemyMl2};
+MovLayer enemyMl0 = { &enemyCenter, {0,FIX(7)}, &enemyMl1};
  
 char score = 0;                  /** Score ones place */
 char scoreDecimal = 0;           /** Score decimal place */
 char scoreStr[11] = "score: 00"; /** Score string */
 char indexScore = 8;             /** Score index */
+const AbText scoreText = {abTextGetBounds, abTextCheck, &fontGame, 9, scoreStr}; // score - text
+Layer scoreLayer = { (AbShape *)&scoreText, LAYER_POS(screenWidth - 45 + 22, 2 + 4), LAYER_POS(0,0), LAYER_POS(0,0), COLOR_WHITE, &enemyCenter }; // top-left at (screenWidth - 45, 2)
+const AbText titleText = {abTextGetBounds, abTextCheck, &fontGame, 19, "Evade the obstacles"};
+const AbText startText = {abTextGetBounds, abTextCheck, &fontGame, 17, "Press S1 to Start"};
+const AbText overText = {abTextGetBounds, abTextCheck, &fontGame, 9, "Game Over"};
+const AbText againText = {abTextGetBounds, abTextCheck, &fontGame, 22, "Press S1 to play again"};
+Layer hintLayer = { (AbShape *)&startText, LAYER_POS(screenWidth/2, screenHeight/2 - 36), LAYER_POS(0,0), LAYER_POS(0,0), COLOR_BLACK, &scoreLayer }; // second line of the message
+Layer headLayer = { (AbShape *)&titleText, LAYER_POS(screenWidth/2, screenHeight/2 - 46), LAYER_POS(0,0), LAYER_POS(0,0), COLOR_BLACK, &hintLayer }; // first line of the message
+LayerList gameLayers;            /** Message, score, enemies, car, grass & field, top first */
 short transitionSpeed = 30;      /** number of interrupts */
 char isGameOver = 0;             /** Boolean that determins if the game is over */
 u_int bgColor = 0xcdff - 1;      /** Background color */
 int redrawScreen = 1;            /** Boolean for whether screen needs to be redrawn */
+char redrawRequested = 0;        /** Boolean for restarting the full redraw */
+char message = MSG_TITLE;        /** Message the next full redraw shows */
+LayerRedraw fullRedraw;          /** Full redraw, a band of rows per frame */
+#define REDRAW_ROWS 16           /** Rows of the full redraw per frame */
 char showInstruction = 1;        /** Boolean for shwoing the instruction */ 
 Region fieldFence;		 /** Fence around playing field  */
-
-/** Readraws moving layers in their next location 
- *  
- *  \param movLayers Linked list containing the shapes that will move
- *  \param layers Linked list containing all the layers in the game
- */
-movLayerDraw(MovLayer *movLayers, Layer *layers)
-{
-  int row, col;
-  MovLayer *movLayer;
-
-  and_sr(~8);			/**< disable interrupts (GIE off) */
-  for (movLayer = movLayers; movLayer; movLayer = movLayer->next) { /* for each moving layer */
-    Layer *l = movLayer->layer;
-    l->posLast = l->pos;
-    l->pos = l->posNext;
-  }
-  or_sr(8);			/**< disable interrupts (GIE on) */
-
-
-  for (movLayer = movLayers; movLayer; movLayer = movLayer->next) { /* for each moving layer */
-    Region bounds;
-    layerGetBounds(movLayer->layer, &bounds);
-    lcd_setArea(bounds.topLeft.axes[0], bounds.topLeft.axes[1], 
-		bounds.botRight.axes[0], bounds.botRight.axes[1]);
-    for (row = bounds.topLeft.axes[1]; row <= bounds.botRight.axes[1]; row++) {
-      for (col = bounds.topLeft.axes[0]; col <= bounds.botRight.axes[0]; col++) {
-	Vec2 pixelPos = {col, row};
-	u_int color = bgColor;
-	Layer *probeLayer;
-	for (probeLayer = layers; probeLayer; 
-	     probeLayer = probeLayer->next) { /* probe all layers, in order */
-	  if (abShapeCheck(probeLayer->abShape, &probeLayer->pos, &pixelPos)) {
-	    color = probeLayer->color;
-	    break; 
-	  } /* if probe check */
-	} // for checking all layers at col, row
-	lcd_writeColor(color); 
-      } // for col
-    } // for row
-  } // for moving layer being updated
-}	  
+BgCache background;             /** Field and grass, precomposited */
 
 /** Determines the enemies next position
  *  
@@ -119,17 +84,19 @@ void enemyAdvance(MovLayer *ml, Region *fence)
   u_char axis;
   Region shapeBoundary;
   for (; ml; ml = ml->next) {
-    vec2Add(&newPos, &ml->layer->posNext, &ml->velocity);
+    vec2FixStep(&ml->posFix, &ml->velocity);
+    vec2FixToPixels(&newPos, &ml->posFix);
     abShapeGetBounds(ml->layer->abShape, &newPos, &shapeBoundary);
     // if the enemy reaches the bottom, move it to the top again
     if(shapeBoundary.topLeft.axes[1] > screenHeight-20){
+      ml->posFix.axes[1] = FIX(-10);
       newPos.axes[1] = -10;
-      ml->velocity.axes[1] += 1;
+      ml->velocity.axes[1] += FIX(1);
       ml->layer->color += 0x0f00;
       score++;
     }
     
-    ml->layer->posNext = newPos;
+    layerPosSet(&ml->layer->posNext, &newPos);
   } /**< for ml */
 }
 
@@ -146,7 +113,8 @@ void moveCar(MovLayer *ml, Region *fence)
   Region shapeBoundary;
 
   for (; ml; ml = ml->next) {
-    vec2Add(&newPos, &ml->layer->posNext, &ml->velocity);
+    vec2FixStep(&ml->posFix, &ml->velocity);
+    vec2FixToPixels(&newPos, &ml->posFix);
     abShapeGetBounds(ml->layer->abShape, &newPos, &shapeBoundary);
     //moves the car horizontally if possible
     if(newPos.axes[0] + carHorOffset > 20 &&
@@ -158,35 +126,98 @@ void moveCar(MovLayer *ml, Region *fence)
        newPos.axes[1] + carVerOffset < screenHeight){
       newPos.axes[1] = newPos.axes[1] + carVerOffset;
     }
-    ml->layer->posNext = newPos;
+    vec2FixFromPixels(&ml->posFix, &newPos);
+    and_sr(~8);			/**< checkForCollision (in the WDT handler) reads posNext */
+    layerPosSet(&ml->layer->posNext, &newPos);
+    or_sr(8);
   } /**< for ml */
 }
 
 /** Determines if the car has a collision with any of the enemies
+ *
+ *  An enemy hits the car when any pixel of the car lies within the
+ *  enemy's bounding box, so narrow enemies can't slip between corners.
+ *  This runs from the watchdog interrupt, so the car is tested at its
+ *  posNext, which moveCar writes with interrupts off, rather than at
+ *  pos, which main's movLayerUpdate may be rewriting.
  *  
- *  \param enemy Linked list containing the car shapes
+ *  \param enemy Linked list containing the enemy shapes
  *  \param car Linked list containing the car shapes
+ *  \return 1 at the first hit (setting isGameOver), else 0
  */
 char checkForCollision(MovLayer *enemy, MovLayer *car){
   
-  Region carBounday;
-  Region enemyBoundary;
-  Vec2 coordinates;
+  Region carBoundary;
+  Region overlap;		/**< of an enemy's bounds with the car's */
+  Vec2 coordinates, carPos, pixel;
   
-  abShapeGetBounds(car->layer->abShape, &car->layer->posNext, &carBounday);
+  layerPosGet(&car->layer->posNext, &carPos);
+  abShapeGetBounds(car->layer->abShape, &carPos, &carBoundary);
   for (; enemy; enemy = enemy->next) {
-    vec2Add(&coordinates, &enemy->layer->pos, &enemy->velocity);
-    abShapeGetBounds(enemy->layer->abShape, &coordinates, &enemyBoundary);
+    vec2FixToPixels(&coordinates, &enemy->posFix); /**< pos after this step */
+    abShapeGetBounds(enemy->layer->abShape, &coordinates, &overlap);
+    regionIntersect(&overlap, &carBoundary, &overlap);
 
-    // check if the enemy corner pixels are inside the boundaries of the car
-    if( abShapeCheck(car->layer->abShape, &car->layer->pos, &enemyBoundary.topLeft) ||
-        abShapeCheck(car->layer->abShape, &car->layer->pos, &enemyBoundary.botRight) ){
-      isGameOver = 1;
-    }
+    // look for a car pixel inside the overlap (empty if the bounds are apart)
+    for (pixel.axes[1] = overlap.topLeft.axes[1];
+	 pixel.axes[1] <= overlap.botRight.axes[1]; pixel.axes[1]++)
+      for (pixel.axes[0] = overlap.topLeft.axes[0];
+	   pixel.axes[0] <= overlap.botRight.axes[0]; pixel.axes[0]++)
+	if (abShapeCheck(car->layer->abShape, &carPos, &pixel)) {
+	  isGameOver = 1;
+	  return 1;		/**< one hit ends the game */
+	}
   }  
   return 0;
 }
 
+/** Hides the enemies (so they cost nothing to draw) or shows them again
+ *
+ *  \param hidden Nonzero to hide
+ */
+void hideEnemies(u_char hidden){
+  MovLayer *ml;
+  for (ml = &enemyMl0; ml; ml = ml->next)
+    layerSetHidden(ml->layer, hidden, 0); // the screen is redrawn after
+}
+
+/** Shows text as layer l, centered on row, or hides l if text is 0
+ *
+ *  \param l One of the message layers
+ *  \param text The line to show
+ *  \param row Its center row
+ */
+void showText(Layer *l, const AbText *text, int row){
+  if (text) {
+    Vec2 center = {screenWidth/2, row};
+    l->abShape = (AbShape *)text;
+    layerPosSet(&l->pos, &center);
+    l->posLast = l->posNext = l->pos;
+    layerUpdateBounds(l);
+  }
+  layerSetHidden(l, !text, 0); // the screen is redrawn after
+}
+
+/** Shows msg (MSG_NONE, MSG_TITLE or MSG_GAME_OVER) in the message
+ *  layers, hiding the enemies behind the game over message.  Called by
+ *  main, so the layers never change while they are being drawn.
+ *
+ *  \param msg The message
+ */
+void showMessage(char msg){
+  hideEnemies(msg == MSG_GAME_OVER);
+  if (msg == MSG_GAME_OVER) {
+    showText(&headLayer, &overText, screenHeight/2 + 4);
+    showText(&hintLayer, &againText, screenHeight/2 + 14);
+  } else if (msg == MSG_TITLE) {
+    showText(&headLayer, &titleText, screenHeight/2 - 46);
+    showText(&hintLayer, &startText, screenHeight/2 - 36);
+  } else {
+    showText(&headLayer, 0, 0);
+    showText(&hintLayer, 0, 0);
+  }
+}
+
 /** Reads switches and determines in which direction the car has to move
  */
 void readSwitches(){
@@ -216,18 +247,25 @@ void readSwitches(){
   }
 }
 
-/** Draws the score in the top right corner
+/** Updates the score in the top right corner, invalidating it if it changed
+ *
+ *  \param dirty Regions of the screen to be redrawn this frame
  */
-void drawTheScore(){
-  // draw the score as long as the game oves is not over
+void updateTheScore(DirtyList *dirty){
+  // update the score as long as the game oves is not over
   if(!isGameOver){
+    char ones = scoreStr[8], tens = scoreStr[7];
     if(scoreStr[8] == '9'){
       scoreDecimal++;
       scoreStr[7] = '0' + scoreDecimal;
       score = 0;
     }
     scoreStr[indexScore] = '0' + score;
-    drawString5x7(screenWidth - 45, 2, scoreStr, COLOR_WHITE, COLOR_BLACK );
+    if(scoreStr[8] != ones || scoreStr[7] != tens){ // redrawn with the moving layers
+      Region bounds;
+      layerGetBounds(&scoreLayer, &bounds);
+      dirtyAdd(dirty, &bounds);
+    }
   }
 }
 
@@ -236,6 +274,7 @@ void drawTheScore(){
  */
 void main()
 {
+  DirtyList dirty;		/**< Regions to redraw this frame */
   P1DIR |= GREEN_LED;		/**< Green led on when CPU on */	       
 
   configureClocks();
@@ -243,13 +282,16 @@ void main()
   buzzer_init();
   p2sw_init(15);
   
-  layerInit(&enemyCenter);
-  layerDraw(&enemyCenter);
+  dirtyInit(&dirty);
+  fieldLayer.flags = grassLeftSide.flags = grassRightSide.flags = LAYER_STATIC;
+  layerListInit(&gameLayers, &headLayer);
+  movLayerInit(&ml0);
+  movLayerInit(&enemyMl0);
+  if (bgCacheBuild(&background, gameLayers.top)) /**< field & grass drawn from runs */
+    bgCache = &background;
+  layerDraw(gameLayers.top);   /**< title & instruction on the field */
   layerGetBounds(&fieldLayer, &fieldFence);
 
-  drawString5x7(screenWidth/2 -45, screenHeight/2 - 50, "Evade the obstacles", COLOR_WHITE, COLOR_BLACK );
-  drawString5x7(screenWidth/2 -45, screenHeight/2 - 40, "Press S1 to Start", COLOR_WHITE, COLOR_BLACK );
-
   enableWDTInterrupts();      /**< enable periodic interrupt */
   or_sr(0x8);	              /**< GIE (enable interrupts) */
 
@@ -263,9 +305,17 @@ void main()
     redrawScreen = 0;
     carHorOffset = 0;
     carVerOffset = 0;
-    movLayerDraw(&ml0, &car);
-    movLayerDraw(&enemyMl0, &enemyCenter);
-    drawTheScore();
+    movLayerUpdate(&ml0, movLayerDirty, &dirty);
+    movLayerUpdate(&enemyMl0, movLayerDirty, &dirty);
+    updateTheScore(&dirty);
+    dirtyDraw(&dirty, gameLayers.top); /**< overlapping moves & score drawn once */
+    if (redrawRequested) {    /**< (re)start full redraw from the top */
+      redrawRequested = 0;
+      showMessage(message);
+      layerRedrawStart(&fullRedraw);
+    }
+    if (layerRedrawStep(&fullRedraw, gameLayers.top, REDRAW_ROWS))
+      redrawScreen = 1;       /**< more bands next frame */
   }
 }
 
@@ -285,20 +335,23 @@ void state_advance(){
       buzzer_set_period(0);
       currentState = play;
       transitionSpeed = 80;
-      layerDraw(&enemyCenter);
+      message = MSG_NONE;
+      redrawRequested = 1;   // main loop redraws, a band per frame
+      redrawScreen = 1;
     }
     break;
   case play:  // In this state, the user is playing the game
     buzzer_set_period(0); // stop music if something is playing
     if(!isGameOver){     // if game is not over move enemies and check for collisions
       enemyAdvance(&enemyMl0, &fieldFence);
+      movLayerPublish();   // renderer may now copy the new positions
       checkForCollision(&enemyMl0, &ml0);
       redrawScreen = 1;
     }
     else{              // if game is over print game over on the screen and move to next state
-      layerDraw(&enemyCenter);
-      drawString5x7(screenWidth/2 -20, screenHeight/2, "Game Over", COLOR_WHITE, COLOR_BLACK );
-      drawString5x7(screenWidth/2 -55, screenHeight/2 + 10, "Press S1 to play again", COLOR_WHITE, COLOR_BLACK );
+      message = MSG_GAME_OVER; // enemies hidden behind it
+      redrawRequested = 1;  // main loop redraws, a band per frame
+      redrawScreen = 1;
       currentState = game_over;
       transitionSpeed = 30;
     }
@@ -310,22 +363,26 @@ void state_advance(){
       buzzer_play_game_song();
     }
     else{        // if the user press s1, reset all the variables and changes state to play
-      car.posNext.axes[1] = screenHeight/2;
-      car.posNext.axes[0] = screenWidth/2;
-      enemyLeftSide.posNext.axes[1] = -10;
-      enemyRightSide.posNext.axes[1] = -10;
-      enemyCenter.posNext.axes[1] = -10;
+      layerPosAxisSet(car.posNext, 1, screenHeight/2);
+      layerPosAxisSet(car.posNext, 0, screenWidth/2);
+      layerPosAxisSet(enemyLeftSide.posNext, 1, -10);
+      layerPosAxisSet(enemyRightSide.posNext, 1, -10);
+      layerPosAxisSet(enemyCenter.posNext, 1, -10);
       enemyMl0.layer->color = COLOR_YELLOW;
       enemyMl1.layer->color = COLOR_YELLOW;
       enemyMl2.layer->color = COLOR_YELLOW;
-      enemyMl0.velocity.axes[1] = 4;
-      enemyMl1.velocity.axes[1] = 2;
-      enemyMl2.velocity.axes[1] = 3;
-      layerDraw(&enemyCenter);
+      enemyMl0.velocity.axes[1] = FIX(4);
+      enemyMl1.velocity.axes[1] = FIX(2);
+      enemyMl2.velocity.axes[1] = FIX(3);
+      movLayerInit(&ml0);
+      movLayerInit(&enemyMl0);
+      movLayerPublish();
       currentState = play;
       score = 0;
       scoreDecimal = 0;
-      scoreStr[7] = '0';
+      scoreStr[7] = scoreStr[8] = '0';
+      message = MSG_NONE;
+      redrawRequested = 1;
       redrawScreen = 1;
       isGameOver = 0;
       transitionSpeed = 80;
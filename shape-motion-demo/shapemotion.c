@@ -36,8 +36,8 @@ AbRectOutline fieldOutline = {	/* playing field */
   
 Layer layer3 = {		/**< Layer with an orange circle */
   (AbShape *)&circle3,
-  {(screenWidth/2)+10, (screenHeight/2)+5}, /**< bit below & right of center */
-  {0,0}, {0,0},				    /* last & next pos */
+  LAYER_POS((screenWidth/2)+10, (screenHeight/2)+5), /**< bit below & right of center */
+  LAYER_POS(0,0), LAYER_POS(0,0),	    /* last & next pos */
   COLOR_VIOLET,
   0,
 };
@@ -45,112 +45,68 @@ Layer layer3 = {		/**< Layer with an orange circle */
 
 Layer fieldLayer = {		/* playing field as a layer */
   (AbShape *) &fieldOutline,
-  {screenWidth/2, screenHeight/2},/**< center */
-  {0,0}, {0,0},				    /* last & next pos */
+  LAYER_POS(screenWidth/2, screenHeight/2),/**< center */
+  LAYER_POS(0,0), LAYER_POS(0,0),	    /* last & next pos */
   COLOR_BLACK,
   &layer3
 };
 
 Layer layer1 = {		/**< Layer with a red square */
   (AbShape *)&rect10,
-  {screenWidth/2, screenHeight/2}, /**< center */
-  {0,0}, {0,0},				    /* last & next pos */
+  LAYER_POS(screenWidth/2, screenHeight/2), /**< center */
+  LAYER_POS(0,0), LAYER_POS(0,0),	    /* last & next pos */
   COLOR_RED,
   &fieldLayer,
 };
 
 Layer layer0 = {		/**< Layer with an orange circle */
   (AbShape *)&circle14,
-  {(screenWidth/2)+10, (screenHeight/2)+5}, /**< bit below & right of center */
-  {0,0}, {0,0},				    /* last & next pos */
+  LAYER_POS((screenWidth/2)+10, (screenHeight/2)+5), /**< bit below & right of center */
+  LAYER_POS(0,0), LAYER_POS(0,0),	    /* last & next pos */
   COLOR_ORANGE,
   &layer1,
 };
 
-/** Moving Layer
- *  Linked list of layer references
- *  Velocity represents one iteration of change (direction & magnitude)
- */
-typedef struct MovLayer_s {
-  Layer *layer;
-  Vec2 velocity;
-  struct MovLayer_s *next;
-} MovLayer;
-
-/* initial value of {0,0} will be overwritten */
+/* velocities are in 1/16 pixels per tick */
 MovLayer ml3 = { &layer3, {1,1}, 0 }; /**< not all layers move */
 MovLayer ml1 = { &layer1, {1,2}, &ml3 }; 
 MovLayer ml0 = { &layer0, {2,1}, &ml1 }; 
 
-
-
-
-
-
-
-movLayerDraw(MovLayer *movLayers, Layer *layers)
-{
-  int row, col;
-  MovLayer *movLayer;
-
-  and_sr(~8);			/**< disable interrupts (GIE off) */
-  for (movLayer = movLayers; movLayer; movLayer = movLayer->next) { /* for each moving layer */
-    Layer *l = movLayer->layer;
-    l->posLast = l->pos;
-    l->pos = l->posNext;
-  }
-  or_sr(8);			/**< disable interrupts (GIE on) */
-
-
-  for (movLayer = movLayers; movLayer; movLayer = movLayer->next) { /* for each moving layer */
-    Region bounds;
-    layerGetBounds(movLayer->layer, &bounds);
-    lcd_setArea(bounds.topLeft.axes[0], bounds.topLeft.axes[1], 
-		bounds.botRight.axes[0], bounds.botRight.axes[1]);
-    for (row = bounds.topLeft.axes[1]; row <= bounds.botRight.axes[1]; row++) {
-      for (col = bounds.topLeft.axes[0]; col <= bounds.botRight.axes[0]; col++) {
-	Vec2 pixelPos = {col, row};
-	u_int color = bgColor;
-	Layer *probeLayer;
-	for (probeLayer = layers; probeLayer; 
-	     probeLayer = probeLayer->next) { /* probe all layers, in order */
-	  if (abShapeCheck(probeLayer->abShape, &probeLayer->pos, &pixelPos)) {
-	    color = probeLayer->color;
-	    break; 
-	  } /* if probe check */
-	} // for checking all layers at col, row
-	lcd_writeColor(color); 
-      } // for col
-    } // for row
-  } // for moving layer being updated
-}	  
-
-
-
 //Region fence = {{10,30}, {SHORT_EDGE_PIXELS-10, LONG_EDGE_PIXELS-10}}; /**< Create a fence region */
 
 /** Advances a moving shape within a fence
  *  
  *  \param ml The moving shape to be advanced
  *  \param fence The region which will serve as a boundary for ml
+ *  \return Nonzero if any layer's next pixel position changed
  */
-void mlAdvance(MovLayer *ml, Region *fence)
+int mlAdvance(MovLayer *ml, Region *fence)
 {
-  Vec2 newPos;
+  Vec2 newPos, oldPos;
   u_char axis;
   Region shapeBoundary;
+  int moved = 0;
   for (; ml; ml = ml->next) {
-    vec2Add(&newPos, &ml->layer->posNext, &ml->velocity);
+    Vec2Fix posFix = ml->posFix;
+    vec2FixStep(&posFix, &ml->velocity);
+    vec2FixToPixels(&newPos, &posFix);
     abShapeGetBounds(ml->layer->abShape, &newPos, &shapeBoundary);
     for (axis = 0; axis < 2; axis ++) {
       if ((shapeBoundary.topLeft.axes[axis] < fence->topLeft.axes[axis]) ||
 	  (shapeBoundary.botRight.axes[axis] > fence->botRight.axes[axis]) ) {
 	int velocity = ml->velocity.axes[axis] = -ml->velocity.axes[axis];
-	newPos.axes[axis] += (2*velocity);
+	posFix.axes[axis] += (2*velocity);
       }	/**< if outside of fence */
     } /**< for axis */
-    ml->layer->posNext = newPos;
+    ml->posFix = posFix;
+    vec2FixToPixels(&newPos, &posFix); /**< quantize only for drawing */
+    layerPosGet(&ml->layer->posNext, &oldPos);
+    if (newPos.axes[0] != oldPos.axes[0] || newPos.axes[1] != oldPos.axes[1]) {
+      layerPosSet(&ml->layer->posNext, &newPos);
+      moved = 1;
+    }
   } /**< for ml */
+  return moved;
 }
 
 
@@ -177,6 +133,7 @@ void main()
 
   layerInit(&layer0);
   layerDraw(&layer0);
+  movLayerInit(&ml0);
 
 
   layerGetBounds(&fieldLayer, &fieldFence);
@@ -200,14 +157,11 @@ void main()
 /** Watchdog timer interrupt handler. 15 interrupts/sec */
 void wdt_c_handler()
 {
-  static short count = 0;
   P1OUT |= GREEN_LED;		      /**< Green LED on when cpu on */
-  count ++;
-  if (count == 15) {
-    mlAdvance(&ml0, &fieldFence);
+  if (mlAdvance(&ml0, &fieldFence)) { /**< sub-pixel steps every tick */
+    movLayerPublish();		      /**< a complete frame of posNext */
     if (p2sw_read())
       redrawScreen = 1;
-    count = 0;
-  } 
+  }
   P1OUT &= ~GREEN_LED;		    /**< Green LED off when cpu off */
 }
@@ -0,0 +1,56 @@
+#include "shape.h"
+
+static const u_char bitMask[8] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
+
+/** GetBounds function required by AbShape
+ */
+void
+abBitmapGetBounds(const AbBitmap *bitmap, const Vec2 *centerPos, Region *bounds)
+{
+  bounds->topLeft.axes[0] = centerPos->axes[0] - (bitmap->width >> 1);
+  bounds->topLeft.axes[1] = centerPos->axes[1] - (bitmap->height >> 1);
+  bounds->botRight.axes[0] = bounds->topLeft.axes[0] + bitmap->width - 1;
+  bounds->botRight.axes[1] = bounds->topLeft.axes[1] + bitmap->height - 1;
+}
+
+/** Check function required by AbShape
+ *  Rows and columns off the mask are huge when unsigned.
+ */
+int
+abBitmapCheck(const AbBitmap *bitmap, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  u_int row = pixel->axes[1] - centerPos->axes[1] + (bitmap->height >> 1);
+  u_int col = pixel->axes[0] - centerPos->axes[0] + (bitmap->width >> 1);
+  if (row >= bitmap->height || col < bitmap->colFirst[row] || col > bitmap->colLast[row])
+    return 0;
+  return bitmap->bits[(row << bitmap->rowShift) + (col >> 3)] & bitMask[col & 7];
+}
+
+/** Span function (see AbSpanClass)
+ */
+int
+abBitmapGetSpans(const AbBitmap *bitmap, const Vec2 *centerPos, int row, Span *spans)
+{
+  int left = centerPos->axes[0] - (bitmap->width >> 1);
+  u_int r = row - centerPos->axes[1] + (bitmap->height >> 1);
+  const u_char *bits;
+  u_char col, colMin, colLast;
+  int numSpans = 0;
+  if (r >= bitmap->height)
+    return 0;
+  bits = &bitmap->bits[r << bitmap->rowShift];
+  col = bitmap->colFirst[r];	/* set, unless the row is empty */
+  colLast = bitmap->colLast[r];
+  while (col <= colLast) {
+    colMin = col;
+    while (col <= colLast && (bits[col >> 3] & bitMask[col & 7]))
+      col++;
+    if (numSpans == SPANS_MAX)
+      return -1;		/* too many: caller must probe pixels */
+    spans[numSpans].colMin = left + colMin;
+    spans[numSpans++].colMax = left + col - 1;
+    while (col <= colLast && !(bits[col >> 3] & bitMask[col & 7]))
+      col++;
+  }
+  return numSpans;
+}
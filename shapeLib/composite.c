@@ -0,0 +1,174 @@
+#include "shape.h"
+#include "vec2inline.h"
+
+typedef int (*AbCheckFn)(const AbShape *, const Vec2 *, const Vec2 *);
+
+void
+abCompositeInit(AbComposite *comp)
+{
+  u_char i;
+  for (i = 0; i < comp->numParts; i++) {
+    AbPart *part = &comp->parts[i];
+    Vec2 partPos;		/* on screen: some getBounds clip to it */
+    if (part->shape->check == (AbCheckFn)abCompositeCheck)
+      abCompositeInit((AbComposite *)part->shape); /* its bounds first */
+    vec2AddInline(&partPos, &screenCenter, &part->offset);
+    abShapeGetBounds(part->shape, &partPos, &part->bounds);
+    vec2SubInline(&part->bounds.topLeft, &part->bounds.topLeft, &screenCenter);
+    vec2SubInline(&part->bounds.botRight, &part->bounds.botRight, &screenCenter);
+    part->shapeType = abShapeType(part->shape);
+  }
+}
+
+void
+abCompositeGetBounds(const AbComposite *comp, const Vec2 *centerPos, Region *bounds)
+{
+  u_char i;
+  *bounds = comp->parts[0].bounds;
+  if (comp->op != AB_DIFFERENCE)
+    for (i = 1; i < comp->numParts; i++) {
+      if (comp->op == AB_UNION)
+	regionUnionInline(bounds, bounds, &comp->parts[i].bounds);
+      else
+	regionIntersect(bounds, bounds, &comp->parts[i].bounds);
+    }
+  vec2AddInline(&bounds->topLeft, &bounds->topLeft, centerPos);
+  vec2AddInline(&bounds->botRight, &bounds->botRight, centerPos);
+}
+
+/* true if part contains pixel (rel is pixel relative to centerPos) */
+static int
+abPartCheck(const AbPart *part, const Vec2 *centerPos, const Vec2 *pixel, const Vec2 *rel)
+{
+  const Region *b = &part->bounds;
+  Vec2 partPos;
+  if ((u_int)(rel->axes[0] - b->topLeft.axes[0]) >
+      (u_int)(b->botRight.axes[0] - b->topLeft.axes[0]) ||
+      (u_int)(rel->axes[1] - b->topLeft.axes[1]) >
+      (u_int)(b->botRight.axes[1] - b->topLeft.axes[1]))
+    return 0;
+  if (part->shapeType == ABSHAPE_RECT) /* fills its bounds */
+    return 1;
+  vec2AddInline(&partPos, centerPos, &part->offset);
+  return abShapeCheck(part->shape, &partPos, pixel);
+}
+
+int
+abCompositeCheck(const AbComposite *comp, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  const AbPart *part = comp->parts, *end = part + comp->numParts;
+  Vec2 rel;
+  vec2SubInline(&rel, pixel, centerPos);
+  switch (comp->op) {
+  case AB_UNION:
+    for (; part < end; part++)
+      if (abPartCheck(part, centerPos, pixel, &rel))
+	return 1;
+    return 0;
+  case AB_INTERSECT:
+    for (; part < end; part++)
+      if (!abPartCheck(part, centerPos, pixel, &rel))
+	return 0;
+    return 1;
+  default:			/* AB_DIFFERENCE */
+    if (!abPartCheck(part++, centerPos, pixel, &rel))
+      return 0;
+    for (; part < end; part++)
+      if (abPartCheck(part, centerPos, pixel, &rel))
+	return 0;
+    return 1;
+  }
+}
+
+/* Append [colMin, colMax] to the n spans in out, merging it with the
+ * last if they touch.  Returns the new count, or -1 if out is full.
+ */
+static int
+spanAppend(Span *out, int n, int colMin, int colMax)
+{
+  if (n && colMin <= out[n-1].colMax + 1) {
+    if (colMax > out[n-1].colMax)
+      out[n-1].colMax = colMax;
+    return n;
+  }
+  if (n == SPANS_MAX)
+    return -1;
+  out[n].colMin = colMin;
+  out[n].colMax = colMax;
+  return n + 1;
+}
+
+/* Combine span lists a and b (each left to right and disjoint) into out
+ * by op.  Returns the number of spans in out, or -1 if too many.
+ */
+static int
+spansCombine(u_char op, const Span *a, int na, const Span *b, int nb, Span *out)
+{
+  int i = 0, j = 0, n = 0;
+  switch (op) {
+  case AB_UNION:
+    while (n >= 0 && (i < na || j < nb)) {
+      const Span *s = (j == nb || (i < na && a[i].colMin < b[j].colMin)) ? &a[i++] : &b[j++];
+      n = spanAppend(out, n, s->colMin, s->colMax);
+    }
+    return n;
+  case AB_INTERSECT:
+    while (n >= 0 && i < na && j < nb) {
+      int colMin = a[i].colMin > b[j].colMin ? a[i].colMin : b[j].colMin;
+      int colMax = a[i].colMax < b[j].colMax ? a[i].colMax : b[j].colMax;
+      if (colMin <= colMax)
+	n = spanAppend(out, n, colMin, colMax);
+      if (a[i].colMax < b[j].colMax) i++; else j++;
+    }
+    return n;
+  default:			/* AB_DIFFERENCE: a minus b */
+    for (; n >= 0 && i < na; i++) {
+      int col = a[i].colMin;
+      for (; j < nb && b[j].colMin <= a[i].colMax; j++) {
+	if (b[j].colMax < col)
+	  continue;
+	if (b[j].colMin > col)
+	  n = spanAppend(out, n, col, b[j].colMin - 1);
+	col = b[j].colMax + 1;
+	if (b[j].colMax > a[i].colMax)
+	  break;		/* b[j] may cover the next a span too */
+      }
+      if (n >= 0 && col <= a[i].colMax)
+	n = spanAppend(out, n, col, a[i].colMax);
+    }
+    return n;
+  }
+}
+
+int
+abCompositeGetSpans(const AbComposite *comp, const Vec2 *centerPos, int row, Span *spans)
+{
+  Span partSpans[SPANS_MAX], combined[SPANS_MAX];
+  int relRow = row - centerPos->axes[1];
+  int i, n = 0, numPart;	/* spans in spans & partSpans */
+  for (i = 0; i < comp->numParts; i++) {
+    const AbPart *part = &comp->parts[i];
+    Vec2 partPos;
+    if (relRow < part->bounds.topLeft.axes[1] || relRow > part->bounds.botRight.axes[1]) {
+      if (comp->op == AB_UNION || (comp->op == AB_DIFFERENCE && i))
+	continue;		/* adds or removes nothing */
+      return 0;			/* nothing left to intersect or subtract from */
+    }
+    vec2AddInline(&partPos, centerPos, &part->offset);
+    if (!i) {			/* first part: start with its spans */
+      n = abShapeTypeGetSpans(part->shapeType, part->shape, &partPos, row, spans);
+      if (n < 0)
+	return -1;
+      continue;
+    }
+    numPart = abShapeTypeGetSpans(part->shapeType, part->shape, &partPos, row, partSpans);
+    if (numPart < 0)
+      return -1;
+    n = spansCombine(comp->op, spans, n, partSpans, numPart, combined);
+    if (n < 0)
+      return -1;
+    for (numPart = 0; numPart < n; numPart++)
+      spans[numPart] = combined[numPart];
+  }
+  return n;
+}
@@ -0,0 +1,103 @@
+#include "shape.h"
+#include "vec2inline.h"
+
+void
+dirtyInit(DirtyList *d)
+{
+  d->numRects = 0;
+}
+
+/* pixels wasted by the bounding box of r1 and r2 (u gets the box) */
+static long
+dirtyWaste(Region *u, const Region *r1, const Region *r2)
+{
+  regionUnionInline(u, r1, r2);
+  return regionArea(u) - regionArea(r1) - regionArea(r2);
+}
+
+/* replace d->rects[i] with u, joined with the rects it then overlaps
+   (keeps them disjoint without adding any) */
+static void
+dirtyAbsorb(DirtyList *d, Region *u, u_char i)
+{
+  u_char j, joined;
+  Region inter;
+  d->rects[i] = d->rects[--d->numRects];
+  do {
+    joined = 0;
+    for (j = 0; j < d->numRects; j++) {
+      regionIntersectInline(&inter, u, &d->rects[j]);
+      if (!regionIsEmptyInline(&inter)) {
+	regionUnionInline(u, u, &d->rects[j]);
+	d->rects[j--] = d->rects[--d->numRects];
+	joined = 1;
+      }
+    }
+  } while (joined);
+  d->rects[d->numRects++] = *u;
+}
+
+void
+dirtyAdd(DirtyList *d, const Region *r)
+{
+  Region cur, u;
+  u_char i, j, best, bestJ;
+  long waste, bestWaste;
+  regionIntersectInline(&cur, r, &layerClip);
+  if (regionIsEmptyInline(&cur))
+    return;
+  while (d->numRects) {		/* merge with the cheapest neighbor while it pays */
+    for (i = 0; i < d->numRects; i++) {
+      waste = dirtyWaste(&u, &cur, &d->rects[i]);
+      if (!i || waste < bestWaste) {
+	best = i;
+	bestWaste = waste;
+      }
+    }
+    if (bestWaste <= DIRTY_RECT_COST) {
+      regionUnionInline(&cur, &cur, &d->rects[best]);
+      d->rects[best] = d->rects[--d->numRects];
+      continue;
+    }
+    if (regionsAdd(d->rects, &d->numRects, DIRTY_MAX, &cur))
+      return;			/* kept what the others don't cover */
+    bestJ = DIRTY_MAX;		/* no room: merge the cheapest pair (DIRTY_MAX means cur) */
+    for (i = 0; i < d->numRects; i++)
+      for (j = i + 1; j < d->numRects; j++)
+	if ((waste = dirtyWaste(&u, &d->rects[i], &d->rects[j])) < bestWaste) {
+	  best = i;
+	  bestJ = j;
+	  bestWaste = waste;
+	}
+    if (bestJ != DIRTY_MAX) {
+      regionUnionInline(&u, &d->rects[best], &d->rects[bestJ]);
+      d->rects[bestJ] = d->rects[--d->numRects]; /* best < bestJ stays put */
+      dirtyAbsorb(d, &u, best);
+      continue;
+    }
+    regionUnionInline(&cur, &cur, &d->rects[best]);
+    d->rects[best] = d->rects[--d->numRects];
+  }
+  d->rects[d->numRects++] = cur;
+}
+
+void
+dirtyAddLayer(DirtyList *d, const Layer *l)
+{
+  Region exposed[4];
+  u_char i, n = layerGetExposed(l, exposed);
+  Region bounds;
+  layerBoundsGet(l, &bounds);
+  dirtyAdd(d, &bounds);
+  for (i = 0; i < n; i++)
+    dirtyAdd(d, &exposed[i]);
+}
+
+void
+dirtyDraw(DirtyList *d, Layer *layers)
+{
+  u_char i;
+  for (i = 0; i < d->numRects; i++)
+    layerDrawRegion(layers, &d->rects[i]);
+  d->numRects = 0;
+}
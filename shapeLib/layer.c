@@ -1,27 +1,559 @@
 #include "lcdutils.h"
 #include "lcddraw.h"
 #include "shape.h"
+#include "vec2inline.h"
 
-void
-layerDraw(Layer *layers)
+/** A run of one color within the row being composited */
+typedef struct {
+  u_char colMin, colMax;
+  u_int color;
+} RowRun;
+
+/** Runs claimed so far in a row, sorted and disjoint.
+ *  Layers are added top to bottom, so the first claim on a pixel wins.
+ */
+typedef struct {
+  RowRun runs[ROW_RUNS_MAX];
+  u_char numRuns;
+  u_char covered;		/* pixels claimed */
+  u_char overflow;		/* ran out of runs; row must be probed */
+} RowRuns;
+
+/* claim the unclaimed pixels in colMin..colMax for color */
+static void
+rowClaim(RowRuns *rr, int colMin, int colMax, u_int color)
 {
-  int row, col;
-  for (row = 0; row < screenHeight; row++) {
-    lcd_setArea(0, row, screenWidth-1, row);
-    for (col = 0; col < screenWidth; col++) {
+  u_char i = 0, j;
+  while (colMin <= colMax) {
+    int end = colMax;
+    while (i < rr->numRuns && rr->runs[i].colMax < colMin)
+      i++;
+    if (i < rr->numRuns && rr->runs[i].colMin <= colMin) { /* already claimed */
+      colMin = rr->runs[i].colMax + 1;
+      continue;
+    }
+    if (i < rr->numRuns && rr->runs[i].colMin <= end)
+      end = rr->runs[i].colMin - 1; /* stop at next claimed run */
+    rr->covered += end - colMin + 1;
+    if (i && rr->runs[i-1].colMax + 1 == colMin && rr->runs[i-1].color == color) {
+      rr->runs[i-1].colMax = end; /* extend left neighbor */
+      if (i < rr->numRuns && rr->runs[i].colMin == end + 1 && rr->runs[i].color == color) {
+	rr->runs[i-1].colMax = rr->runs[i].colMax; /* and join right neighbor */
+	for (j = i + 1; j < rr->numRuns; j++)
+	  rr->runs[j-1] = rr->runs[j];
+	rr->numRuns--;
+      }
+    } else {
+      if (rr->numRuns == ROW_RUNS_MAX) {
+	rr->overflow = 1;
+	return;
+      }
+      for (j = rr->numRuns; j > i; j--)
+	rr->runs[j] = rr->runs[j-1];
+      rr->runs[i].colMin = colMin;
+      rr->runs[i].colMax = end;
+      rr->runs[i].color = color;
+      rr->numRuns++;
+      i++;
+    }
+    colMin = end + 1;
+  }
+}
+
+#if LAYER_STATS
+LayerStats layerStats;
+#define statAdd(field, n) (layerStats.field += (n))
+#else
+#define statAdd(field, n)
+#endif
+
+/* true if l's bounds include row */
+#define layerOnRow(l, row) \
+  layerBoundsIn(row, (l)->bounds.topLeft.axes[1], (l)->bounds.botRight.axes[1])
+
+/* true if l fills its bounds (see LAYER_OPAQUE) */
+#define layerIsOpaque(l) ((l)->shapeType == ABSHAPE_RECT)
+
+/* claim the pixels of row (within area) covered by layer l */
+static void
+rowAddLayer(RowRuns *rr, const Layer *l, int row, const Region *area)
+{
+  int areaMin = area->topLeft.axes[0], areaMax = area->botRight.axes[0];
+  Span spans[SPANS_MAX];
+  Vec2 pos;
+  int i, numSpans;
+  if (!layerOnRow(l, row))
+    return;			/* row misses layer: no call */
+  if (l->bounds.topLeft.axes[0] > areaMin) areaMin = l->bounds.topLeft.axes[0];
+  if (l->bounds.botRight.axes[0] < areaMax) areaMax = l->bounds.botRight.axes[0];
+  if (layerIsOpaque(l)) {	/* covers its bounds: no call */
+    rowClaim(rr, areaMin, areaMax, l->color);
+    return;
+  }
+  layerPosGet(&l->pos, &pos);
+  numSpans = abShapeTypeGetSpans(l->shapeType, l->abShape, &pos, row, spans);
+  if (numSpans < 0) {		/* no spans: check unclaimed pixels within bounds */
+    int col, start = -1;
+    u_char r = 0;
+    for (col = areaMin; col <= areaMax + 1; col++) {
       Vec2 pixelPos = {col, row};
-      u_int color = bgColor;
-      Layer *probeLayer;
-      for (probeLayer = layers; probeLayer; probeLayer = probeLayer->next) {
-	if (abShapeCheck(probeLayer->abShape, &probeLayer->pos, &pixelPos)) {
-	  color = probeLayer->color;
-	  break; 
-	} /* if check */
-      } // for checking all layers at col, row
-      lcd_writeColor(color); 
-    } // for col
+      while (r < rr->numRuns && rr->runs[r].colMax < col)
+	r++;
+      if (col <= areaMax && r < rr->numRuns && rr->runs[r].colMin <= col) {
+	int end = rr->runs[r].colMax < areaMax ? rr->runs[r].colMax : areaMax;
+	statAdd(probesElided, end - col + 1); /* claimed by a layer above */
+	if (start >= 0) {
+	  rowClaim(rr, start, col - 1, l->color);
+	  start = -1;
+	  r = 0;
+	}
+	col = end;
+	continue;
+      }
+      statAdd(probes, col <= areaMax);
+      if (col <= areaMax && layerCheck(l, &pixelPos)) {
+	if (start < 0)
+	  start = col;
+      } else if (start >= 0) {
+	rowClaim(rr, start, col - 1, l->color);
+	start = -1;
+	r = 0;
+      }
+    }
+    return;
+  }
+  for (i = 0; i < numSpans; i++) {
+    int colMin = spans[i].colMin, colMax = spans[i].colMax;
+    if (colMin < areaMin) colMin = areaMin;
+    if (colMax > areaMax) colMax = areaMax;
+    rowClaim(rr, colMin, colMax, l->color);
+  }
+}
+
+/* true if l is hidden, or drawn from bgCache rather than composited */
+#define layerIsSkipped(l) (((l)->flags & LAYER_HIDDEN) || \
+  (bgCache && ((l)->flags & LAYER_STATIC)))
+
+#if LINE_BUF_PIXELS
+/** Pixels composited but not yet sent */
+typedef struct {
+  u_int pixels[LINE_BUF_PIXELS];
+  u_char n;
+} LineBuf;
+
+static LineBuf line;		/* the renderers' (they don't nest) */
+
+/* send the buffered pixels in one burst */
+static void
+lineFlush(LineBuf *lb)
+{
+  lcd_writeColors(lb->pixels, lb->n);
+  lb->n = 0;
+}
+
+/* append count pixels of color, sending the buffer whenever it fills */
+static void
+lineFill(LineBuf *lb, u_int color, u_char count)
+{
+  while (count) {
+    u_char room = LINE_BUF_PIXELS - lb->n, k = count < room ? count : room;
+    u_int *p = &lb->pixels[lb->n];
+    lb->n += k;
+    count -= k;
+    while (k--)
+      *p++ = color;
+    if (lb->n == LINE_BUF_PIXELS)
+      lineFlush(lb);
+  }
+}
+#else
+typedef char LineBuf;		/* unbuffered: pixels are sent as composited */
+#define lineFlush(lb)
+
+static void
+lineFill(LineBuf *lb, u_int color, u_char count)
+{
+  while (count--)
+    lcd_writeColor(color);
+}
+#endif
+
+/* emit background for columns col..colEnd-1 (bg: row's cached runs, or 0) */
+static void
+bgEmit(LineBuf *lb, const BgRun *bg, int col, int colEnd)
+{
+  if (!bg) {
+    lineFill(lb, bgColor, colEnd - col);
+    return;
+  }
+  while (bg->colMax < col)
+    bg++;
+  while (col < colEnd) {
+    int end = bg->colMax < colEnd - 1 ? bg->colMax : colEnd - 1;
+    lineFill(lb, bg->color, end - col + 1);
+    col = end + 1;
+    bg++;
+  }
+}
+
+/* emit a row's runs, filling gaps between them with the background */
+static void
+rowEmit(LineBuf *lb, const RowRuns *rr, const Region *area, const BgRun *bg)
+{
+  int col = area->topLeft.axes[0];
+  u_char i;
+  for (i = 0; i <= rr->numRuns; i++) {
+    int runMin = (i < rr->numRuns) ? rr->runs[i].colMin : area->botRight.axes[0] + 1;
+    if (col < runMin) {
+      bgEmit(lb, bg, col, runMin);
+      col = runMin;
+    }
+    if (i < rr->numRuns) {
+      lineFill(lb, rr->runs[i].color, rr->runs[i].colMax - col + 1);
+      col = rr->runs[i].colMax + 1;
+    }
+  }
+}
+
+/** Layers sorted by top row, with an active set of those whose rows
+ *  include the current row (like a scanline active-edge table).
+ *  The active set is a bitmask indexed by z order (0 is the top layer).
+ */
+typedef struct {
+  Layer *byZ[LAYERS_MAX];
+  u_char byTop[LAYERS_MAX];	/* z indices sorted by top row */
+  u_char numLayers, nextTop;
+  u_int active;
+} RowCull;
+
+/* add l to the cull table (below those already added) */
+static int
+rowCullInsert(RowCull *rc, Layer *l)
+{
+  u_char z = rc->numLayers, i;
+  int top = l->bounds.topLeft.axes[1];
+  if (z == LAYERS_MAX)
+    return 0;
+  rc->byZ[z] = l;
+  for (i = z; i && rc->byZ[rc->byTop[i-1]]->bounds.topLeft.axes[1] > top; i--)
+    rc->byTop[i] = rc->byTop[i-1]; /* insertion sort */
+  rc->byTop[i] = z;
+  rc->numLayers = z + 1;
+  return 1;
+}
+
+/* true if l is opaque and its bounds include area */
+static int
+layerCovers(const Layer *l, const Region *area)
+{
+  return layerIsOpaque(l) &&
+    l->bounds.topLeft.axes[0] <= layerCoord(area->topLeft.axes[0]) &&
+    l->bounds.topLeft.axes[1] <= layerCoord(area->topLeft.axes[1]) &&
+    l->bounds.botRight.axes[0] >= layerCoord(area->botRight.axes[0]) &&
+    l->bounds.botRight.axes[1] >= layerCoord(area->botRight.axes[1]);
+}
+
+/* true if l's bounds miss area (on the screen) */
+#define layerMisses(l, area) \
+  ((l)->bounds.topLeft.axes[0] > layerCoord((area)->botRight.axes[0]) || \
+   (l)->bounds.botRight.axes[0] < layerCoord((area)->topLeft.axes[0]) || \
+   (l)->bounds.topLeft.axes[1] > layerCoord((area)->botRight.axes[1]) || \
+   (l)->bounds.botRight.axes[1] < layerCoord((area)->topLeft.axes[1]))
+
+/* build cull table of the layers visible within area;
+   returns 0 if there are too many layers to cull */
+static int
+rowCullInit(RowCull *rc, Layer *layers, const Region *area)
+{
+  rc->numLayers = rc->nextTop = 0;
+  rc->active = 0;
+  for (; layers; layers = layers->next) {
+    if (layerIsSkipped(layers) || layerMisses(layers, area))
+      continue;
+    if (!rowCullInsert(rc, layers))
+      return 0;
+    if (layerCovers(layers, area))
+      break;			/* layers below are hidden */
+  }
+  return 1;
+}
+
+/* add the active layers to row's runs (in z order), retiring finished ones */
+static void
+rowCullAdd(RowCull *rc, RowRuns *rr, int row, const Region *area, u_char width)
+{
+  u_char z;
+  u_int bit, active;
+  while (rc->nextTop < rc->numLayers &&
+	 rc->byZ[rc->byTop[rc->nextTop]]->bounds.topLeft.axes[1] <= layerCoord(row))
+    rc->active |= 1u << rc->byTop[rc->nextTop++];
+  for (z = 0, bit = 1, active = rc->active; active; z++, bit <<= 1) {
+    Layer *l = rc->byZ[z];
+    if (!(active & bit))
+      continue;
+    active &= ~bit;
+    if (l->bounds.botRight.axes[1] < layerCoord(row)) {
+      rc->active &= ~bit;	/* layer is above this row for good */
+      continue;
+    }
+    if (rr->covered >= width || rr->overflow)
+      break;
+    rowAddLayer(rr, l, row, area);
+  }
+}
+
+/* first layer to probe: rc's top layer, or if rc is 0, the list's */
+static Layer *
+probeFirst(const RowCull *rc, Layer *layers, u_char *z)
+{
+  *z = 0;
+  if (rc)
+    return rc->numLayers ? rc->byZ[0] : 0;
+  while (layers && layerIsSkipped(layers))
+    layers = layers->next;
+  return layers;
+}
+
+/* layer to probe after l (at z) */
+static Layer *
+probeNext(const RowCull *rc, Layer *l, u_char *z)
+{
+  if (rc)
+    return ++*z < rc->numLayers ? rc->byZ[*z] : 0;
+  for (l = l->next; l && layerIsSkipped(l); l = l->next)
+    ;
+  return l;
+}
+
+/* composite one row pixel by pixel (used when a row has too many runs).
+   Probes rc's layers, or if rc is 0, the list layers.  Where the
+   topmost opaque layer on row lies under no other layer on row, its
+   pixels are filled as one run without probes. */
+static void
+rowProbe(LineBuf *lb, const RowCull *rc, Layer *layers, int row, const Region *area,
+	 const BgRun *bg)
+{
+  Layer *l, *occluder = 0;
+  u_char z, depth = 0;		/* probes per pixel to reach occluder */
+  int col;
+  for (l = probeFirst(rc, layers, &z); l; l = probeNext(rc, l, &z)) {
+    depth++;
+    if (!layerOnRow(l, row))
+      continue;
+    if (layerIsOpaque(l))
+      occluder = l;
+    break;			/* only the first layer on row can be */
+  }
+  for (col = area->topLeft.axes[0]; col <= area->botRight.axes[0]; col++) {
+    Vec2 pixelPos = {col, row};
+    if (occluder && layerBoundsIn(col, occluder->bounds.topLeft.axes[0],
+				  occluder->bounds.botRight.axes[0])) {
+      int end = occluder->bounds.botRight.axes[0];
+      if (end > area->botRight.axes[0])
+	end = area->botRight.axes[0];
+      lineFill(lb, occluder->color, end - col + 1);
+      statAdd(probesElided, (unsigned long)(end - col + 1) * depth);
+      col = end;
+      continue;
+    }
+    for (l = probeFirst(rc, layers, &z); l; l = probeNext(rc, l, &z)) {
+      statAdd(probes, 1);
+      if (layerCheck(l, &pixelPos))
+	break;
+    } // for checking all layers at col, row
+    if (l)
+      lineFill(lb, l->color, 1);
+    else
+      bgEmit(lb, bg, col, col + 1);
+  } // for col
+}
+
+/* render area from rc's layers, or if rc is 0, all of the list layers */
+static void
+drawRows(RowCull *rc, Layer *layers, const Region *area)
+{
+  int row;
+  u_char width = area->botRight.axes[0] - area->topLeft.axes[0] + 1;
+  u_char band = 0;
+  const BgRun *bg = 0;
+#if LINE_BUF_PIXELS
+  LineBuf *lb = &line;
+  lb->n = 0;
+#else
+  LineBuf *lb = 0;
+#endif
+  lcd_setArea(area->topLeft.axes[0], area->topLeft.axes[1],
+	      area->botRight.axes[0], area->botRight.axes[1]);
+  for (row = area->topLeft.axes[1]; row <= area->botRight.axes[1]; row++) {
+    RowRuns rr;
+    Layer *l;
+    rr.numRuns = rr.covered = rr.overflow = 0;
+    if (bgCache) {		/* find row's background band */
+      while (bgCache->bands[band].rowMax < row)
+	band++;
+      bg = &bgCache->runs[bgCache->bands[band].firstRun];
+    }
+    if (rc)			/* only layers that overlap row */
+      rowCullAdd(rc, &rr, row, area, width);
+    else
+      for (l = layers; l && rr.covered < width && !rr.overflow; l = l->next)
+	if (!layerIsSkipped(l))
+	  rowAddLayer(&rr, l, row, area);
+    if (rr.overflow)
+      rowProbe(lb, rc, layers, row, area, bg);
+    else
+      rowEmit(lb, &rr, area, bg);
   } // for row
-} 
+  lineFlush(lb);
+}
+
+Region layerClip = {{0, 0}, {screenWidth-1, screenHeight-1}};
+static Region clipStack[LAYER_CLIP_DEPTH]; /* clips saved by layerClipPush */
+static u_char clipDepth;
+
+int
+layerClipPush(const Region *r)
+{
+  if (clipDepth == LAYER_CLIP_DEPTH)
+    return 0;
+  clipStack[clipDepth++] = layerClip;
+  regionIntersectInline(&layerClip, &layerClip, r);
+  return 1;
+}
+
+void
+layerClipPop(void)
+{
+  if (clipDepth)
+    layerClip = clipStack[--clipDepth];
+}
+
+void
+layerDrawRegion(Layer *layers, const Region *area)
+{
+  RowCull rc;
+  Region clipped;
+  regionIntersectInline(&clipped, area, &layerClip);
+  if (regionIsEmptyInline(&clipped))
+    return;
+  drawRows(rowCullInit(&rc, layers, &clipped) ? &rc : 0, layers, &clipped);
+}
+
+void
+layerDrawArray(Layer *const layers[], u_char numLayers, const Region *area)
+{
+  RowCull rc;
+  Region clipped;
+  u_char i;
+  regionIntersectInline(&clipped, area, &layerClip);
+  if (regionIsEmptyInline(&clipped))
+    return;
+  rc.numLayers = rc.nextTop = 0;
+  rc.active = 0;
+  for (i = 0; i < numLayers; i++)
+    if (!layerIsSkipped(layers[i]) && !layerMisses(layers[i], &clipped)) {
+      rowCullInsert(&rc, layers[i]);
+      if (layerCovers(layers[i], &clipped))
+	break;			/* layers below are hidden */
+    }
+  drawRows(&rc, 0, &clipped);
+}
+
+const BgCache *bgCache;
+
+/* append a run ending at colMax, extending the last if the same color */
+static int
+bgRunAdd(BgRun *runs, u_char *n, u_char room, u_char colMax, u_int color)
+{
+  if (*n && runs[*n-1].color == color) {
+    runs[*n-1].colMax = colMax;
+    return 1;
+  }
+  if (*n == room)
+    return 0;
+  runs[*n].colMax = colMax;
+  runs[(*n)++].color = color;
+  return 1;
+}
+
+int
+bgCacheBuild(BgCache *cache, Layer *layers)
+{
+  Region screen = {{0, 0}, {screenWidth-1, screenHeight-1}};
+  int row;
+  cache->numRuns = cache->numBands = 0;
+  for (row = 0; row < screenHeight; row++) {
+    RowRuns rr;
+    Layer *l;
+    BgRun *runs = &cache->runs[cache->numRuns]; /* row's runs, if new */
+    u_char room = BG_RUNS_MAX - cache->numRuns;
+    u_char i, n = 0, col = 0;
+    rr.numRuns = rr.covered = rr.overflow = 0;
+    for (l = layers; l && !rr.overflow; l = l->next)
+      if ((l->flags & (LAYER_STATIC | LAYER_HIDDEN)) == LAYER_STATIC)
+	rowAddLayer(&rr, l, row, &screen);
+    if (rr.overflow)
+      goto full;
+    for (i = 0; i <= rr.numRuns; i++) { /* gap before run i, then run i */
+      u_char gapEnd = (i < rr.numRuns) ? rr.runs[i].colMin : screenWidth;
+      if (col < gapEnd && !bgRunAdd(runs, &n, room, gapEnd - 1, bgColor))
+	goto full;
+      if (i < rr.numRuns) {
+	if (!bgRunAdd(runs, &n, room, rr.runs[i].colMax, rr.runs[i].color))
+	  goto full;
+	col = rr.runs[i].colMax + 1;
+      }
+    }
+    if (cache->numBands) {	/* same as previous band's row? */
+      BgBand *prev = &cache->bands[cache->numBands-1];
+      if (cache->numRuns - prev->firstRun == n) {
+	for (i = 0; i < n && cache->runs[prev->firstRun + i].colMax == runs[i].colMax &&
+	       cache->runs[prev->firstRun + i].color == runs[i].color; i++)
+	  ;
+	if (i == n) {
+	  prev->rowMax = row;
+	  continue;
+	}
+      }
+    }
+    if (cache->numBands == BG_BANDS_MAX)
+      goto full;
+    cache->bands[cache->numBands].rowMax = row;
+    cache->bands[cache->numBands++].firstRun = cache->numRuns;
+    cache->numRuns += n;
+  }
+  return 1;
+ full:
+  cache->numRuns = cache->numBands = 0;
+  return 0;
+}
+
+void
+layerDraw(Layer *layers)
+{
+  Region screen = {{0, 0}, {screenWidth-1, screenHeight-1}};
+  layerDrawRegion(layers, &screen);
+}
+
+void
+layerRedrawStart(LayerRedraw *redraw)
+{
+  redraw->rowsLeft = screenHeight;
+}
+
+u_char
+layerRedrawStep(LayerRedraw *redraw, Layer *layers, u_char rows)
+{
+  Region band = {{0, 0}, {screenWidth-1, 0}};
+  if (rows > redraw->rowsLeft)
+    rows = redraw->rowsLeft;
+  if (!rows)
+    return 0;
+  band.topLeft.axes[1] = screenHeight - redraw->rowsLeft;
+  band.botRight.axes[1] = band.topLeft.axes[1] + rows - 1;
+  layerDrawRegion(layers, &band);
+  return redraw->rowsLeft -= rows;
+}
 
 
 
@@ -29,17 +561,60 @@ void
 layerGetBounds(const Layer *l, Region *bounds)
 {
   Region lastBounds, curBounds;
-  abShapeGetBounds(l->abShape, &l->posLast, &lastBounds);
-  abShapeGetBounds(l->abShape, &l->pos, &curBounds);
-  regionUnion(bounds, &curBounds, &lastBounds);
+  Vec2 pos;
+  layerPosGet(&l->posLast, &pos);
+  abShapeGetBounds(l->abShape, &pos, &lastBounds);
+  layerPosGet(&l->pos, &pos);
+  abShapeGetBounds(l->abShape, &pos, &curBounds);
+  regionUnionInline(bounds, &curBounds, &lastBounds);
   regionClipScreen(bounds);
 }
 
+u_char
+layerGetExposed(const Layer *l, Region exposed[4])
+{
+  Region old, cur;
+  Vec2 pos;
+  layerPosGet(&l->posLast, &pos);
+  abShapeGetBounds(l->abShape, &pos, &old);
+  layerBoundsGet(l, &cur);
+  return regionSubtract(exposed, &old, &cur);
+}
+
+void
+layerUpdateBounds(Layer *l)
+{
+  Region b;
+  Vec2 pos;
+  l->shapeType = (l->flags & LAYER_OPAQUE) ? ABSHAPE_RECT : abShapeType(l->abShape);
+  layerPosGet(&l->pos, &pos);
+  abShapeGetBounds(l->abShape, &pos, &b);
+#if LAYER_COORD8
+  regionClipScreen(&b);		/* to fit in bytes */
+#endif
+  if (regionIsEmptyInline(&b)) { /* clipped away */
+#if LAYER_COORD8
+    b.topLeft.axes[0] = b.topLeft.axes[1] = 255; /* matches no pixel */
+#else
+    b.topLeft.axes[0] = b.topLeft.axes[1] = -1000;
+#endif
+    b.botRight = b.topLeft;
+  }
+  l->bounds.topLeft.axes[0] = b.topLeft.axes[0];
+  l->bounds.topLeft.axes[1] = b.topLeft.axes[1];
+  l->bounds.botRight.axes[0] = b.botRight.axes[0];
+  l->bounds.botRight.axes[1] = b.botRight.axes[1];
+}
+
 void
 layerInit(Layer *layer)
 {
-  for (; layer; layer = layer->next)
+  Layer *prev = 0;
+  for (; layer; prev = layer, layer = layer->next) {
+    layer->prev = prev;
     layer->posLast = layer->posNext = layer->pos;
+    layerUpdateBounds(layer);
+  }
 }
 
 /* void */
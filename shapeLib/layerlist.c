@@ -0,0 +1,91 @@
+#include "shape.h"
+
+/* invalidate l's bounds at pos and posLast in dirty (if any) */
+static void
+layerInvalidate(const Layer *l, DirtyList *dirty)
+{
+  Region bounds;
+  if (!dirty || (l->flags & LAYER_HIDDEN))
+    return;			/* not drawn */
+  layerGetBounds(l, &bounds);
+  dirtyAdd(dirty, &bounds);
+}
+
+/* link l between above and below (either may be 0) */
+static void
+layerLink(LayerList *list, Layer *l, Layer *above, Layer *below)
+{
+  l->prev = above;
+  l->next = below;
+  if (above)
+    above->next = l;
+  else
+    list->top = l;
+  if (below)
+    below->prev = l;
+}
+
+/* unlink l from list */
+static void
+layerUnlink(LayerList *list, Layer *l)
+{
+  if (l->prev)
+    l->prev->next = l->next;
+  else
+    list->top = l->next;
+  if (l->next)
+    l->next->prev = l->prev;
+  l->prev = l->next = 0;
+}
+
+void
+layerListInit(LayerList *list, Layer *top)
+{
+  list->top = top;
+  layerInit(top);
+}
+
+void
+layerListInsert(LayerList *list, Layer *l, u_char z, DirtyList *dirty)
+{
+  Layer *above = 0, *below = list->top;
+  for (; z && below; z--) {
+    above = below;
+    below = below->next;
+  }
+  layerLink(list, l, above, below);
+  l->posLast = l->posNext = l->pos;
+  layerUpdateBounds(l);
+  layerInvalidate(l, dirty);
+}
+
+void
+layerListRemove(LayerList *list, Layer *l, DirtyList *dirty)
+{
+  layerInvalidate(l, dirty);
+  layerUnlink(list, l);
+}
+
+void
+layerListToFront(LayerList *list, Layer *l, DirtyList *dirty)
+{
+  if (list->top == l)
+    return;
+  layerUnlink(list, l);
+  layerLink(list, l, 0, list->top);
+  layerInvalidate(l, dirty);	/* now drawn over the layers it overlaps */
+}
+
+void
+layerSetHidden(Layer *l, u_char hidden, DirtyList *dirty)
+{
+  if (!hidden == !(l->flags & LAYER_HIDDEN))
+    return;			/* no change */
+  if (hidden) {
+    layerInvalidate(l, dirty);	/* while still drawn */
+    l->flags |= LAYER_HIDDEN;
+  } else {
+    l->flags &= ~LAYER_HIDDEN;
+    layerInvalidate(l, dirty);
+  }
+}
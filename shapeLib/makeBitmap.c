@@ -0,0 +1,177 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "assert.h"
+
+// Generate an AbBitmap from a PBM image.
+//
+// usage: makeBitmap [-n name] image.pbm
+//
+// Black (1) pixels are part of the shape.  Plain (P1) and raw (P4) PBM
+// files are accepted, such as those exported by most image editors.
+// The image is cropped to its black pixels, which are centered on the
+// shape's position.  name.c and name.h are written to the current
+// directory; name.c defines "const AbBitmap name" (name defaults to
+// the image's file name without its extension).
+
+#define SIZE_MAX_PIXELS 128	/* AbBitmap width & height */
+
+unsigned char pixels[SIZE_MAX_PIXELS][SIZE_MAX_PIXELS];
+
+// read the next number of a PBM header, skipping whitespace and comments
+int readHeaderNum(FILE *fp)
+{
+  int c, val;
+  while ((c = getc(fp)) != EOF) {
+    if (c == '#')
+      while ((c = getc(fp)) != EOF && c != '\n')
+	;
+    else if (c >= '0' && c <= '9')
+      break;
+  }
+  for (val = 0; c >= '0' && c <= '9'; c = getc(fp))
+    val = val * 10 + c - '0';
+  return val;			/* the one whitespace after it is consumed */
+}
+
+void readPbm(const char *filename, int *width, int *height)
+{
+  FILE *fp = fopen(filename, "rb");
+  int raw, row, col;
+  if (!fp || getc(fp) != 'P' || ((raw = getc(fp)) != '1' && raw != '4')) {
+    fprintf(stderr, "makeBitmap: %s is not a PBM (P1 or P4) file\n", filename);
+    exit(1);
+  }
+  raw = raw == '4';
+  *width = readHeaderNum(fp);
+  *height = readHeaderNum(fp);
+  if (*width < 1 || *width > SIZE_MAX_PIXELS || *height < 1 || *height > SIZE_MAX_PIXELS) {
+    fprintf(stderr, "makeBitmap: %s must be 1 to %d pixels on each side\n",
+	    filename, SIZE_MAX_PIXELS);
+    exit(1);
+  }
+  for (row = 0; row < *height; row++)
+    for (col = 0; col < *width; col++) {
+      int c;
+      if (raw) {		/* rows are padded to whole bytes */
+	static int byte;
+	if (!(col & 7))
+	  byte = getc(fp);
+	c = byte == EOF ? EOF : (byte >> (7 - (col & 7))) & 1;
+      } else {
+	while ((c = getc(fp)) != EOF && c != '0' && c != '1')
+	  if (c == '#')
+	    while ((c = getc(fp)) != EOF && c != '\n')
+	      ;
+	if (c != EOF)
+	  c -= '0';
+      }
+      if (c == EOF) {
+	fprintf(stderr, "makeBitmap: %s is truncated\n", filename);
+	exit(1);
+      }
+      pixels[row][col] = c;
+    }
+  fclose(fp);
+}
+
+int main(int argc, char **argv)
+{
+  const char *imageName = 0;
+  char name[100], filename[110];
+  int width, height, rowMin, rowMax, colMin, colMax, row, col, argi;
+  int rowShift, rowBytes;
+  FILE *fp;
+
+  name[0] = 0;
+  for (argi = 1; argi < argc; argi++) {
+    if (!strcmp(argv[argi], "-n") && argi + 1 < argc)
+      snprintf(name, sizeof(name), "%s", argv[++argi]);
+    else
+      imageName = argv[argi];
+  }
+  if (!imageName) {
+    fprintf(stderr, "usage: makeBitmap [-n name] image.pbm\n");
+    exit(1);
+  }
+  if (!name[0]) {		/* file name without directory or extension */
+    const char *base = strrchr(imageName, '/');
+    snprintf(name, sizeof(name), "%s", base ? base + 1 : imageName);
+    if (strchr(name, '.'))
+      *strchr(name, '.') = 0;
+  }
+
+  readPbm(imageName, &width, &height);
+  rowMin = colMin = SIZE_MAX_PIXELS;
+  rowMax = colMax = -1;
+  for (row = 0; row < height; row++)
+    for (col = 0; col < width; col++)
+      if (pixels[row][col]) {
+	if (row < rowMin) rowMin = row;
+	if (row > rowMax) rowMax = row;
+	if (col < colMin) colMin = col;
+	if (col > colMax) colMax = col;
+      }
+  if (rowMax < 0) {
+    fprintf(stderr, "makeBitmap: %s has no black pixels\n", imageName);
+    exit(1);
+  }
+  width = colMax - colMin + 1;
+  height = rowMax - rowMin + 1;
+  for (rowShift = 0; (1 << rowShift) * 8 < width; rowShift++) /* rows are 2^n bytes */
+    ;
+  rowBytes = 1 << rowShift;
+
+  sprintf(filename, "%s.c", name);
+  fp = fopen(filename, "w");
+  assert(fp);
+  fprintf(fp, "// Automatically generated by makeBitmap from %s.\n", imageName);
+  fprintf(fp, "#include \"shape.h\"\n");
+  fprintf(fp, "#include \"%s.h\"\n\n", name);
+  fprintf(fp, "static const u_char bits[%d] = {\n", height * rowBytes);
+  for (row = rowMin; row <= rowMax; row++) {
+    int b;
+    fprintf(fp, " ");
+    for (b = 0; b < rowBytes; b++) {
+      int byte = 0, bit;
+      for (bit = 0; bit < 8; bit++) {
+	col = colMin + b * 8 + bit;
+	if (col <= colMax && pixels[row][col])
+	  byte |= 0x80 >> bit;
+      }
+      fprintf(fp, " 0x%02x,", byte);
+    }
+    fprintf(fp, " // ");
+    for (col = colMin; col <= colMax; col++)
+      putc(pixels[row][col] ? '#' : '.', fp);
+    fprintf(fp, "\n");
+  }
+  fprintf(fp, "};\n\n");
+  fprintf(fp, "static const u_char colFirst[%d] = {", height);
+  for (row = rowMin; row <= rowMax; row++) {
+    for (col = colMin; col <= colMax && !pixels[row][col]; col++)
+      ;
+    fprintf(fp, "%s%d,", ((row - rowMin) % 16) ? " " : "\n  ", col <= colMax ? col - colMin : 255);
+  }
+  fprintf(fp, "\n};\n\n");
+  fprintf(fp, "static const u_char colLast[%d] = {", height);
+  for (row = rowMin; row <= rowMax; row++) {
+    for (col = colMax; col >= colMin && !pixels[row][col]; col--)
+      ;
+    fprintf(fp, "%s%d,", ((row - rowMin) % 16) ? " " : "\n  ", col >= colMin ? col - colMin : 0);
+  }
+  fprintf(fp, "\n};\n\n");
+  fprintf(fp, "const AbBitmap %s = {abBitmapGetBounds, abBitmapCheck, %d, %d, %d, bits, colFirst, colLast};\n",
+	  name, width, height, rowShift);
+  fclose(fp);
+
+  sprintf(filename, "%s.h", name);
+  fp = fopen(filename, "w");
+  assert(fp);
+  fprintf(fp, "// Automatically generated by makeBitmap.\n");
+  fprintf(fp, "#ifndef %s_included\n#define %s_included\n\n", name, name);
+  fprintf(fp, "extern const AbBitmap %s;\t/* %dx%d */\n", name, width, height);
+  fprintf(fp, "\n#endif // included \n");
+  fclose(fp);
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "signal.h"
+#include "sys/time.h"
+#include "libTimer.h"
+#include "shape.h"
+
+// Host stress test for movLayerUpdate (built and run by "make test").
+//
+// A SIGALRM handler stands in for the watchdog interrupt handler: it
+// writes a new frame to every layer's posNext and calls
+// movLayerPublish().  It re-arms the timer with a random 1-20 us delay,
+// so frames are published at random points, including midway through
+// movLayerUpdate's copy of posNext to pos.  get_sr, and_sr and or_sr
+// are stubbed to block SIGALRM while GIE is clear.  Every snapshot the
+// reader takes must be one complete frame: all layers in the same
+// column.
+
+#define NUM_LAYERS 32
+#define SNAPSHOTS 200000
+
+AbRect dot = {abRectGetBounds, abRectCheck, {1, 1}};
+Layer layers[NUM_LAYERS];
+MovLayer movLayers[NUM_LAYERS];
+u_int bgColor = COLOR_BLACK;
+
+volatile long frames;		/* published by the handler */
+volatile long midCopy;		/* handler found the copy half done */
+volatile char inUpdate;		/* reader is in movLayerUpdate */
+long windows;			/* copies made with interrupts off */
+
+// the renderers are not exercised
+void lcd_setArea(u_char colMin, u_char rowMin, u_char colMax, u_char rowMax) {}
+void lcd_writeColor(u_int colorBGR) {}
+void lcd_writeColors(const u_int *colorsBGR, u_int count) {}
+
+// the status register's GIE bit, as SIGALRM's mask
+static sigset_t alarmSet;
+static unsigned char sr = 8;
+
+unsigned char get_sr() { return sr; }
+
+void and_sr(int bits)
+{
+  sr &= bits;
+  if (!(sr & 8)) {
+    sigprocmask(SIG_BLOCK, &alarmSet, 0);
+    windows++;
+  }
+}
+
+void or_sr(int bits)
+{
+  sr |= bits;
+  if (sr & 8)
+    sigprocmask(SIG_UNBLOCK, &alarmSet, 0);
+}
+
+void armTimer()
+{
+  struct itimerval it = {{0, 0}, {0, 1 + rand() % 20}};
+  setitimer(ITIMER_REAL, &it, 0);
+}
+
+// the simulated interrupt: publish the next frame
+void timerHandler(int sig)
+{
+  int i, col = 10 + (frames + 1) % 100;
+  if (inUpdate && layerPosAxis(layers[0].pos, 0) != layerPosAxis(layers[NUM_LAYERS-1].pos, 0))
+    midCopy++;
+  for (i = 0; i < NUM_LAYERS; i++)
+    layerPosAxisSet(layers[i].posNext, 0, col);
+  frames++;
+  movLayerPublish();
+  armTimer();
+}
+
+int main()
+{
+  long snapshot, torn = 0;
+  int i;
+  for (i = 0; i < NUM_LAYERS; i++) {
+    layers[i].abShape = (AbShape *)&dot;
+    layerPosAxisSet(layers[i].pos, 0, 10);
+    layerPosAxisSet(layers[i].pos, 1, 4 + 4 * i);
+    layers[i].next = (i + 1 < NUM_LAYERS) ? &layers[i+1] : 0;
+    movLayers[i].layer = &layers[i];
+    movLayers[i].next = (i + 1 < NUM_LAYERS) ? &movLayers[i+1] : 0;
+  }
+  layerInit(layers);
+  movLayerInit(movLayers);
+  sigemptyset(&alarmSet);
+  sigaddset(&alarmSet, SIGALRM);
+  signal(SIGALRM, timerHandler);
+  armTimer();
+
+  for (snapshot = 0; snapshot < SNAPSHOTS; snapshot++) {
+    inUpdate = 1;
+    movLayerUpdate(movLayers, 0, 0);
+    inUpdate = 0;
+    for (i = 1; i < NUM_LAYERS; i++)
+      if (layerPosAxis(layers[i].pos, 0) != layerPosAxis(layers[0].pos, 0)) {
+	torn++;
+	break;
+      }
+  }
+  signal(SIGALRM, SIG_IGN);
+
+  printf("movLayerTest: %ld snapshots, %ld frames, %ld published mid-copy, "
+	 "%ld copied with interrupts off, %ld torn\n",
+	 (long)SNAPSHOTS, frames, midCopy, windows, torn);
+  if (!midCopy) {
+    printf("movLayerTest: no frame was published mid-copy; test proves nothing\n");
+    return 1;
+  }
+  return torn != 0;
+}
@@ -0,0 +1,74 @@
+#include "libTimer.h"
+#include "shape.h"
+
+volatile u_int movLayerSeq;
+
+/* copies tried before the frame is copied with interrupts off */
+#ifndef MOVLAYER_TRIES
+#define MOVLAYER_TRIES 4
+#endif
+
+/* copy every layer's posNext to pos */
+static void
+movLayerCopy(MovLayer *ml)
+{
+  for (; ml; ml = ml->next)
+    ml->layer->pos = ml->layer->posNext;
+}
+
+void
+movLayerInit(MovLayer *movLayers)
+{
+  for (; movLayers; movLayers = movLayers->next) {
+    Vec2 pos;
+    layerPosGet(&movLayers->layer->posNext, &pos);
+    vec2FixFromPixels(&movLayers->posFix, &pos);
+  }
+}
+
+void
+movLayerUpdate(MovLayer *movLayers, MovLayerHook hook, void *arg)
+{
+  MovLayer *ml;
+  u_int seq;
+  u_char tries = 0;
+  for (ml = movLayers; ml; ml = ml->next)
+    ml->layer->posLast = ml->layer->pos;
+  do {				/* until no frame was published mid-copy */
+    if (++tries > MOVLAYER_TRIES) { /* publisher keeps winning: one window */
+      u_char gie = get_sr() & 8;
+      and_sr(~8);
+      movLayerCopy(movLayers);
+      if (gie)
+	or_sr(8);
+      break;
+    }
+    seq = movLayerSeq;
+    __asm__ __volatile__("" ::: "memory"); /* read posNext after seq */
+    movLayerCopy(movLayers);
+    __asm__ __volatile__("" ::: "memory"); /* ... and before rereading it */
+  } while (seq != movLayerSeq);
+  for (ml = movLayers; ml; ml = ml->next) {
+    Layer *l = ml->layer;
+    if (!layerMoved(l))
+      continue;			/* still on the same pixel */
+    layerUpdateBounds(l);
+    if (hook)
+      hook(arg, l);
+  }
+}
+
+void
+movLayerDirty(void *dirty, const Layer *l)
+{
+  dirtyAddLayer((DirtyList *)dirty, l);
+}
+
+void
+movLayerDraw(MovLayer *movLayers, Layer *layers)
+{
+  DirtyList dirty;
+  dirtyInit(&dirty);
+  movLayerUpdate(movLayers, movLayerDirty, &dirty);
+  dirtyDraw(&dirty, layers);	/* overlapping regions are drawn once */
+}
@@ -0,0 +1,99 @@
+#include "shape.h"
+#include "vec2inline.h"
+
+/** GetBounds function required by AbShape
+ */
+void
+abPatternGetBounds(const AbPattern *pat, const Vec2 *centerPos, Region *bounds)
+{
+  vec2SubInline(&bounds->topLeft, centerPos, &pat->halfSize);
+  vec2AddInline(&bounds->botRight, centerPos, &pat->halfSize);
+}
+
+/* signed pos modulo period (non-zero), without dividing */
+static int
+wrapSigned(int pos, u_int period)
+{
+  if (pos >= 0)
+    return patternWrap(pos, period);
+  return period - 1 - patternWrap(-(pos + 1), period);
+}
+
+int
+abPatternSetPhase(AbPattern *pat, int colPhase, int rowPhase)
+{
+  u_int width = patternWidth(pat->pattern), height = patternHeight(pat->pattern);
+  if (!width || !height)
+    return 0;
+  pat->phase.axes[0] = wrapSigned(colPhase, width);
+  pat->phase.axes[1] = wrapSigned(rowPhase, height);
+  return 1;
+}
+
+/** Check function required by AbShape
+ *  true if pixel is within the pattern's rectangle and not in a gap run
+ */
+int
+abPatternCheck(const AbPattern *pat, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  Region bounds;
+  const PatternBand *band;
+  u_char run, left;
+  abPatternGetBounds(pat, centerPos, &bounds);
+  if (pixel->axes[0] < bounds.topLeft.axes[0] || pixel->axes[0] > bounds.botRight.axes[0] ||
+      pixel->axes[1] < bounds.topLeft.axes[1] || pixel->axes[1] > bounds.botRight.axes[1])
+    return 0;
+  /* with phase normalized, wrapping these is a few subtracts at most */
+  band = &pat->pattern->bands[patternFindBand(pat->pattern, pixel->axes[1] -
+					      bounds.topLeft.axes[1] + pat->phase.axes[1], &left)];
+  if (!left)
+    return 0;			/* no rows */
+  run = patternBandFind(band, pixel->axes[0] - bounds.topLeft.axes[0] + pat->phase.axes[0], &left);
+  return left && band->runs[run].colorBGR != pat->gapColor;
+}
+
+/** Spans covered by the pattern in row.
+ *  Adjacent non-gap runs are merged into one span.
+ */
+int
+abPatternGetSpans(const AbPattern *pat, const Vec2 *centerPos, int row, Span *spans)
+{
+  Region bounds;
+  const PatternBand *band;
+  u_char run, left;
+  int col, numSpans = 0, inSpan = 0;
+  abPatternGetBounds(pat, centerPos, &bounds);
+  if (row < bounds.topLeft.axes[1] || row > bounds.botRight.axes[1])
+    return 0;
+  band = &pat->pattern->bands[patternFindBand(pat->pattern, row - bounds.topLeft.axes[1] +
+					      pat->phase.axes[1], &left)];
+  if (!left)
+    return 0;			/* no rows */
+  run = patternBandFind(band, pat->phase.axes[0], &left);
+  if (!left)
+    return 0;			/* no pixels */
+  for (col = bounds.topLeft.axes[0]; col <= bounds.botRight.axes[0]; ) {
+    int runEnd = col + left - 1;
+    if (runEnd > bounds.botRight.axes[0])
+      runEnd = bounds.botRight.axes[0];
+    if (band->runs[run].colorBGR != pat->gapColor) {
+      if (inSpan) {		/* extends previous run */
+	spans[numSpans - 1].colMax = runEnd;
+      } else {
+	if (numSpans == SPANS_MAX)
+	  return -1;		/* too many: caller must probe pixels */
+	spans[numSpans].colMin = col;
+	spans[numSpans++].colMax = runEnd;
+	inSpan = 1;
+      }
+    } else
+      inSpan = 0;
+    col = runEnd + 1;
+    do {			/* skipping runs of no pixels */
+      if (++run == band->numRuns)
+	run = 0;
+      left = band->runs[run].len;
+    } while (!left);
+  }
+  return numSpans;
+}
@@ -0,0 +1,209 @@
+#include "shape.h"
+#include "vec2inline.h"
+
+/* Edge of a polygon being walked one row at a time (integer DDA), as
+   in lcdLib's fillConvexPolygon.  col advances by step each row, plus
+   one more whenever the accumulated remainder err reaches dRow.  v0 and
+   v1 are the ends it was started from, verts[from] and verts[to]. */
+typedef struct {
+  int col, step, rem, err, dRow, rowEnd;
+  Vec2 v0, v1;
+  u_char from, to;
+} PolyEdge;
+
+/* A polygon's two edge chains, walked down from its top vertex.
+   Rows are relative to the polygon's center. */
+typedef struct {
+  const Vec2 *verts;		/* 0 if unused */
+  u_char numVerts;
+  int row, rowTop, rowBot;	/* row of a & b, and the polygon's rows */
+  PolyEdge a, b;
+} PolyWalk;
+
+static PolyWalk walk;		/* the last polygon walked */
+static volatile u_char walkBusy; /* walk is in use (by code an interrupt handler interrupted) */
+
+/* prepare edge to walk from verts[from] down to verts[to] */
+static void
+edgeInit(PolyEdge *e, const Vec2 *verts, u_char from, u_char to)
+{
+  const Vec2 *v0 = &verts[from], *v1 = &verts[to];
+  int dCol = v1->axes[0] - v0->axes[0], dRow = v1->axes[1] - v0->axes[1];
+  e->v0 = *v0; e->v1 = *v1;
+  e->from = from; e->to = to;
+  e->err = 0; e->rowEnd = v1->axes[1];
+  if (!dRow) {			/* horizontal: land on its far end */
+    e->col = v1->axes[0]; e->step = e->rem = 0; e->dRow = 1;
+    return;
+  }
+  e->col = v0->axes[0]; e->dRow = dRow;
+  e->step = dCol / dRow;	/* floor(dCol/dRow): the only divides */
+  e->rem = dCol % dRow;
+  if (e->rem < 0) {
+    e->step--;
+    e->rem += dRow;
+  }
+}
+
+/* advance edge by one row (adds & compares only) */
+static void
+edgeStep(PolyEdge *e)
+{
+  e->col += e->step;
+  e->err += e->rem;
+  if (e->err >= e->dRow) {
+    e->col++;
+    e->err -= e->dRow;
+  }
+}
+
+/* are edge's ends still where it was started from? */
+static int
+edgeValid(const PolyEdge *e, const Vec2 *verts)
+{
+  const Vec2 *v0 = &verts[e->from], *v1 = &verts[e->to];
+  return v0->axes[0] == e->v0.axes[0] && v0->axes[1] == e->v0.axes[1] &&
+    v1->axes[0] == e->v1.axes[0] && v1->axes[1] == e->v1.axes[1];
+}
+
+/* move a chain (dir +1 or -1) onto the edge that spans w's row */
+static void
+chainAdvance(PolyWalk *w, PolyEdge *e, char dir)
+{
+  const Vec2 *verts = w->verts;
+  u_char numVerts = w->numVerts;
+  while (e->rowEnd <= w->row && verts[e->to].axes[1] < w->rowBot) {
+    u_char cur = e->to, next = cur + dir;
+    if (dir < 0 && cur == 0) next = numVerts - 1;
+    else if (next == numVerts) next = 0;
+    edgeInit(e, verts, cur, next);
+  }
+}
+
+/* start walking poly from its top vertex, row rowTop */
+static void
+walkStart(PolyWalk *w, const AbPolygon *poly, int rowTop, int rowBot)
+{
+  const Vec2 *verts = poly->verts;
+  u_char i, top = 0;
+  w->verts = verts;
+  w->numVerts = poly->numVerts;
+  w->row = w->rowTop = rowTop;
+  w->rowBot = rowBot;
+  while (verts[top].axes[1] != rowTop) top++;
+  edgeInit(&w->a, verts, top, top);
+  w->b = w->a;
+  if (rowBot == rowTop)		/* flat: chains never leave the top */
+    for (i = 0; i < poly->numVerts; i++) {
+      if (verts[i].axes[0] < w->a.col) w->a.col = verts[i].axes[0];
+      if (verts[i].axes[0] > w->b.col) w->b.col = verts[i].axes[0];
+    }
+  chainAdvance(w, &w->a, 1);
+  chainAdvance(w, &w->b, -1);
+}
+
+/* walk w to poly's relRow, continuing it if it is a walk of poly above
+   relRow, else restarting it.  A walk is continued only if poly's top
+   and bottom rows and the ends of both its edges are unchanged: of a
+   convex polygon those are the only edges spanning the walk's row, and
+   the rest are read as it steps.  Returns 0 if relRow is outside poly,
+   else sets *colMin and *colMax. */
+static int
+walkTo(PolyWalk *w, const AbPolygon *poly, int relRow, int *colMin, int *colMax)
+{
+  const Vec2 *verts = poly->verts;
+  int rowTop = verts[0].axes[1], rowBot = rowTop;
+  u_char i;
+  for (i = 1; i < poly->numVerts; i++) {
+    if (verts[i].axes[1] < rowTop) rowTop = verts[i].axes[1];
+    if (verts[i].axes[1] > rowBot) rowBot = verts[i].axes[1];
+  }
+  if (relRow < rowTop || relRow > rowBot)
+    return 0;			/* outside its rows: no walking */
+  if (w->verts != verts || w->numVerts != poly->numVerts ||
+      w->rowTop != rowTop || w->rowBot != rowBot || rowTop == rowBot ||
+      w->row > relRow || !edgeValid(&w->a, verts) || !edgeValid(&w->b, verts))
+    walkStart(w, poly, rowTop, rowBot);
+  while (w->row < relRow) {	/* one step per row */
+    edgeStep(&w->a);
+    edgeStep(&w->b);
+    w->row++;
+    chainAdvance(w, &w->a, 1);
+    chainAdvance(w, &w->b, -1);
+  }
+  *colMin = w->a.col < w->b.col ? w->a.col : w->b.col;
+  *colMax = w->a.col < w->b.col ? w->b.col : w->a.col;
+  return 1;
+}
+
+/* the columns (relative to poly's center) of poly's relRow, as walkTo.
+   Uses the kept walk, unless this interrupted a query that is using
+   it: then a walk on the stack starts from the top. */
+static int
+polyRow(const AbPolygon *poly, int relRow, int *colMin, int *colMax)
+{
+  int found;
+  if (walkBusy) {
+    PolyWalk own;
+    own.verts = 0;
+    return walkTo(&own, poly, relRow, colMin, colMax);
+  }
+  walkBusy = 1;
+  __asm__ __volatile__("" ::: "memory"); /* claim walk before using it */
+  found = walkTo(&walk, poly, relRow, colMin, colMax);
+  __asm__ __volatile__("" ::: "memory"); /* ... and release it after */
+  walkBusy = 0;
+  return found;
+}
+
+/** Row span function for AbPolygon
+ *  The polygon's two edge chains are walked down to row; the span runs
+ *  between them.  Columns are rounded like lcdLib's fillConvexPolygon
+ *  so that both render identical pixels.
+ */
+int
+abPolygonGetSpan(const AbPolygon *poly, const Vec2 *centerPos, int row, Span *span)
+{
+  int colMin, colMax;
+  if (!polyRow(poly, row - centerPos->axes[1], &colMin, &colMax))
+    return 0;
+  span->colMin = centerPos->axes[0] + colMin;
+  span->colMax = centerPos->axes[0] + colMax;
+  return 1;
+}
+
+/** Check function required by AbShape
+ *  Rows outside the polygon are rejected before any walking, and
+ *  pixels in the same row reuse its walk.
+ */
+int
+abPolygonCheck(const AbPolygon *poly, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  int colMin, colMax, col = pixel->axes[0] - centerPos->axes[0];
+  if (!polyRow(poly, pixel->axes[1] - centerPos->axes[1], &colMin, &colMax))
+    return 0;
+  return col >= colMin && col <= colMax;
+}
+
+/** GetBounds function required by AbShape
+ */
+void
+abPolygonGetBounds(const AbPolygon *poly, const Vec2 *centerPos, Region *bounds)
+{
+  u_char i;
+  bounds->topLeft = bounds->botRight = poly->verts[0];
+  for (i = 1; i < poly->numVerts; i++) {
+    vec2MinInline(&bounds->topLeft, &bounds->topLeft, &poly->verts[i]);
+    vec2MaxInline(&bounds->botRight, &bounds->botRight, &poly->verts[i]);
+  }
+  vec2AddInline(&bounds->topLeft, &bounds->topLeft, centerPos);
+  vec2AddInline(&bounds->botRight, &bounds->botRight, centerPos);
+}
+
+/** Span function (see AbSpanClass)
+ */
+int
+abPolygonGetSpans(const AbPolygon *poly, const Vec2 *centerPos, int row, Span *spans)
+{
+  return abPolygonGetSpan(poly, centerPos, row, spans);
+}
@@ -1,4 +1,5 @@
 #include "shape.h"
+#include "vec2inline.h"
 
 
 /** Check function required by AbShape
@@ -11,7 +12,7 @@ abRArrowCheck(const AbRArrow *arrow, const Vec2 *centerPos, const Vec2 *pixel)
   int row, col, within = 0;
   int size = arrow->size;
   int halfSize = size/2, quarterSize = halfSize/2;;
-  vec2Sub(&relPos, pixel, centerPos); /* vector from center to pixel */
+  vec2SubInline(&relPos, pixel, centerPos); /* vector from center to pixel */
   row = relPos.axes[1]; col = -relPos.axes[0]; /* note that col is negated */
   row = (row >= 0) ? row : -row;/* row = |row| */
   if (col >= 0) {		/* not to right of arrow */
@@ -38,3 +39,22 @@ abRArrowGetBounds(const AbRArrow *arrow, const Vec2 *centerPos, Region *bounds)
 }
 
 
+
+/** Span function (see AbSpanClass)
+ *  Rows within quarterSize of the center cross the stem and the tip;
+ *  other rows only cross the tip.
+ */
+int
+abRArrowGetSpans(const AbRArrow *arrow, const Vec2 *centerPos, int row, Span *spans)
+{
+  int size = arrow->size;
+  int halfSize = size/2, quarterSize = halfSize/2;
+  int relRow = row - centerPos->axes[1];
+  relRow = (relRow >= 0) ? relRow : -relRow; /* |relRow| */
+  if (relRow > halfSize)
+    return 0;
+  /* covers columns relRow..size (stem) or relRow..halfSize left of tip */
+  spans->colMin = centerPos->axes[0] - ((relRow <= quarterSize) ? size : halfSize);
+  spans->colMax = centerPos->axes[0] - relRow;
+  return 1;
+}
@@ -1,53 +1,78 @@
 #include "shape.h"
+#include "vec2inline.h"
 
 // true if pixel is in rect centerPosed at rectPos
 int 
 abRectCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel)
 {
-  Region bounds;
-  abRectGetBounds(rect, centerPos, &bounds);
-  int within = 1, axis;
-  for (axis = 0; axis < 2; axis ++) {
-    int p = pixel->axes[axis];
-    if (p > bounds.botRight.axes[axis] || p < bounds.topLeft.axes[axis])
-      within = 0;
-  }
-  return within;
+  int colOffset = pixel->axes[0] - centerPos->axes[0];
+  int rowOffset = pixel->axes[1] - centerPos->axes[1];
+  int halfCols = rect->halfSize.axes[0], halfRows = rect->halfSize.axes[1];
+  return (colOffset >= -halfCols && colOffset <= halfCols &&
+	  rowOffset >= -halfRows && rowOffset <= halfRows);
 }
 
 // compute bounding box in screen coordinates for rect at centerPos
 void abRectGetBounds(const AbRect *rect, const Vec2 *centerPos, Region *bounds)
 {
-  vec2Sub(&bounds->topLeft, centerPos, &rect->halfSize);
-  vec2Add(&bounds->botRight, centerPos, &rect->halfSize);
+  vec2SubInline(&bounds->topLeft, centerPos, &rect->halfSize);
+  vec2AddInline(&bounds->botRight, centerPos, &rect->halfSize);
 }
 
 
 
-// true if pixel is in rect centerPosed at rectPos
+// true if pixel is on the outline of rect centerPosed at rectPos
 int 
 abRectOutlineCheck(const AbRectOutline *rect, const Vec2 *centerPos, const Vec2 *pixel)
 {
-  Region bounds;
-  abRectOutlineGetBounds(rect, centerPos, &bounds);
-  int col = pixel->axes[0], row = pixel->axes[1];
-  return (
-	  ((col == bounds.topLeft.axes[0] || col == bounds.botRight.axes[0])
-	   && 
-	   (row >= bounds.topLeft.axes[1] && row <= bounds.botRight.axes[1]))
-	  ||
-	  ((row == bounds.topLeft.axes[1] || row == bounds.botRight.axes[1])
-	   &&
-	   (col >= bounds.topLeft.axes[0] && col <= bounds.botRight.axes[0]))
-	  );
+  int colOffset = pixel->axes[0] - centerPos->axes[0];
+  int rowOffset = pixel->axes[1] - centerPos->axes[1];
+  int halfCols = rect->halfSize.axes[0], halfRows = rect->halfSize.axes[1];
+  colOffset = (colOffset >= 0) ? colOffset : -colOffset; /* outline is symmetric */
+  rowOffset = (rowOffset >= 0) ? rowOffset : -rowOffset;
+  return ((colOffset == halfCols && rowOffset <= halfRows) ||
+	  (rowOffset == halfRows && colOffset <= halfCols));
 }
  
 // compute bounding box in screen coordinates for rect at centerPos
 void abRectOutlineGetBounds(const AbRectOutline *rect, const Vec2 *centerPos, Region *bounds)
 {
-  vec2Sub(&bounds->topLeft, centerPos, &rect->halfSize);
-  vec2Add(&bounds->botRight, centerPos, &rect->halfSize);
+  vec2SubInline(&bounds->topLeft, centerPos, &rect->halfSize);
+  vec2AddInline(&bounds->botRight, centerPos, &rect->halfSize);
 }
 
 
 
+
+// spans of row covered by rect centered at centerPos
+int
+abRectGetSpans(const AbRect *rect, const Vec2 *centerPos, int row, Span *spans)
+{
+  int rowOffset = row - centerPos->axes[1];
+  if (rowOffset < -rect->halfSize.axes[1] || rowOffset > rect->halfSize.axes[1])
+    return 0;
+  spans->colMin = centerPos->axes[0] - rect->halfSize.axes[0];
+  spans->colMax = centerPos->axes[0] + rect->halfSize.axes[0];
+  return 1;
+}
+
+// spans of row covered by outline centered at centerPos: its top and
+// bottom rows are solid, other rows are just the two sides
+int
+abRectOutlineGetSpans(const AbRectOutline *rect, const Vec2 *centerPos, int row, Span *spans)
+{
+  int rowOffset = row - centerPos->axes[1];
+  int colMin = centerPos->axes[0] - rect->halfSize.axes[0];
+  int colMax = centerPos->axes[0] + rect->halfSize.axes[0];
+  if (rowOffset < -rect->halfSize.axes[1] || rowOffset > rect->halfSize.axes[1])
+    return 0;
+  if (rowOffset == -rect->halfSize.axes[1] || rowOffset == rect->halfSize.axes[1] ||
+      colMin == colMax) {
+    spans->colMin = colMin;
+    spans->colMax = colMax;
+    return 1;
+  }
+  spans[0].colMin = spans[0].colMax = colMin;
+  spans[1].colMin = spans[1].colMax = colMax;
+  return 2;
+}
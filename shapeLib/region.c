@@ -1,17 +1,146 @@
 #include "shape.h"
+#include "vec2inline.h"
+
+static const Vec2 screenMax = {screenWidth - 1, screenHeight - 1};
 
 // compute union of two regions
 void 
 regionUnion(Region *rUnion, const Region *r1, const Region *r2)
 {
-  vec2Min(&rUnion->topLeft, &r1->topLeft, &r2->topLeft);
-  vec2Max(&rUnion->botRight, &r1->botRight, &r2->botRight);
+  regionUnionInline(rUnion, r1, r2);
+}
+
+// compute intersection of two regions (may be empty)
+void
+regionIntersect(Region *rInter, const Region *r1, const Region *r2)
+{
+  regionIntersectInline(rInter, r1, r2);
+}
+
+int
+regionIsEmpty(const Region *r)
+{
+  return regionIsEmptyInline(r);
+}
+
+long
+regionArea(const Region *r)
+{
+  if (regionIsEmptyInline(r))
+    return 0;
+  return (long)(r->botRight.axes[0] - r->topLeft.axes[0] + 1) *
+    (r->botRight.axes[1] - r->topLeft.axes[1] + 1);
+}
+
+// r1 minus r2: bands above and below r2, then strips left and right of it
+u_char
+regionSubtract(Region pieces[4], const Region *r1, const Region *r2)
+{
+  Region inter;
+  u_char n = 0;
+  if (regionIsEmptyInline(r1))
+    return 0;
+  regionIntersectInline(&inter, r1, r2);
+  if (regionIsEmptyInline(&inter)) {
+    pieces[0] = *r1;		/* disjoint: all of r1 */
+    return 1;
+  }
+  if (r1->topLeft.axes[1] < inter.topLeft.axes[1]) { /* above */
+    pieces[n] = *r1;
+    pieces[n++].botRight.axes[1] = inter.topLeft.axes[1] - 1;
+  }
+  if (r1->botRight.axes[1] > inter.botRight.axes[1]) { /* below */
+    pieces[n] = *r1;
+    pieces[n++].topLeft.axes[1] = inter.botRight.axes[1] + 1;
+  }
+  if (r1->topLeft.axes[0] < inter.topLeft.axes[0]) { /* left */
+    pieces[n] = inter;
+    pieces[n].topLeft.axes[0] = r1->topLeft.axes[0];
+    pieces[n++].botRight.axes[0] = inter.topLeft.axes[0] - 1;
+  }
+  if (r1->botRight.axes[0] > inter.botRight.axes[0]) { /* right */
+    pieces[n] = inter;
+    pieces[n].botRight.axes[0] = r1->botRight.axes[0];
+    pieces[n++].topLeft.axes[0] = inter.botRight.axes[0] + 1;
+  }
+  return n;
 }
 
 // Trims extent of region to screen bounds
 void regionClipScreen(Region *r)
 {
-  vec2Max(&r->topLeft, &r->topLeft, &vec2Zero);
-  vec2Min(&r->botRight, &r->botRight, &screenSize);
+  vec2MaxInline(&r->topLeft, &r->topLeft, &vec2Zero);
+  vec2MinInline(&r->botRight, &r->botRight, &screenMax);
+}
+
+void
+regionListInit(RegionList *list)
+{
+  list->numRects = 0;
+}
+
+/* join rects sharing a whole edge into one, until none do */
+static void
+regionListCoalesce(RegionList *list)
+{
+  u_char i, j, joined;
+  do {
+    joined = 0;
+    for (i = 0; i < list->numRects; i++)
+      for (j = i + 1; j < list->numRects; j++) {
+	Region *a = &list->rects[i], *b = &list->rects[j];
+	if ((a->topLeft.axes[0] == b->topLeft.axes[0] &&
+	     a->botRight.axes[0] == b->botRight.axes[0] &&
+	     (a->botRight.axes[1] + 1 == b->topLeft.axes[1] ||
+	      b->botRight.axes[1] + 1 == a->topLeft.axes[1])) ||
+	    (a->topLeft.axes[1] == b->topLeft.axes[1] &&
+	     a->botRight.axes[1] == b->botRight.axes[1] &&
+	     (a->botRight.axes[0] + 1 == b->topLeft.axes[0] ||
+	      b->botRight.axes[0] + 1 == a->topLeft.axes[0]))) {
+	  regionUnionInline(a, a, b);
+	  *b = list->rects[--list->numRects];
+	  joined = 1;
+	  j--;			/* recheck the rect moved into j */
+	}
+      }
+  } while (joined);
+}
+
+int
+regionsAdd(Region *rects, u_char *numRects, u_char maxRects, const Region *r)
+{
+  u_char i, j, k, n = *numRects, end = n + 1;
+  if (regionIsEmptyInline(r))
+    return 1;
+  if (n == maxRects)
+    return 0;
+  rects[n] = *r;		/* pieces of r are kept in rects[n..end) */
+  for (i = 0; i < n; i++) {
+    for (j = n; j < end; ) {
+      Region pieces[4], inter;
+      u_char numPieces;
+      regionIntersectInline(&inter, &rects[j], &rects[i]);
+      if (regionIsEmptyInline(&inter)) { /* piece misses rects[i] */
+	j++;
+	continue;
+      }
+      numPieces = regionSubtract(pieces, &rects[j], &rects[i]);
+      if (end - 1 + numPieces > maxRects)
+	return 0;		/* *numRects unchanged */
+      rects[j] = rects[--end];
+      for (k = 0; k < numPieces; k++)
+	rects[end++] = pieces[k];
+    }
+  }
+  *numRects = end;
+  return 1;
 }
 
+int
+regionListAdd(RegionList *list, const Region *r)
+{
+  if (!regionsAdd(list->rects, &list->numRects, REGION_LIST_MAX, r))
+    return 0;
+  regionListCoalesce(list);
+  return 1;
+}
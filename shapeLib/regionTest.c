@@ -0,0 +1,259 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "shape.h"
+
+// Host unit tests and micro-benchmark for the region functions
+// (built and run by "make test").
+//
+// Fixed cases pin intersection, emptiness, area and the number of
+// pieces regionSubtract returns; random cases on a small grid check
+// that subtraction pieces and RegionList rectangles cover each pixel
+// exactly once, that a RegionList is unchanged when an add fails, and
+// that a DirtyList's rectangles never overlap.
+
+#define GRID 24			/* random rects lie within GRID x GRID */
+
+int failures;
+
+// dirty.c links the renderers, which are not exercised
+u_int bgColor = COLOR_BLACK;
+void lcd_setArea(u_char colMin, u_char rowMin, u_char colMax, u_char rowMax) {}
+void lcd_writeColor(u_int colorBGR) {}
+void lcd_writeColors(const u_int *colorsBGR, u_int count) {}
+
+#define expect(cond, ...) \
+  do { if (!(cond)) { failures++; printf("regionTest: " __VA_ARGS__); printf("\n"); } } while (0)
+
+Region rect(int col0, int row0, int col1, int row1)
+{
+  Region r = {{col0, row0}, {col1, row1}};
+  return r;
+}
+
+Region randRect()
+{
+  int col0 = rand() % GRID, col1 = rand() % GRID, row0 = rand() % GRID, row1 = rand() % GRID;
+  return rect(col0 < col1 ? col0 : col1, row0 < row1 ? row0 : row1,
+	      col0 < col1 ? col1 : col0, row0 < row1 ? row1 : row0);
+}
+
+int contains(const Region *r, int col, int row)
+{
+  return col >= r->topLeft.axes[0] && col <= r->botRight.axes[0] &&
+    row >= r->topLeft.axes[1] && row <= r->botRight.axes[1];
+}
+
+// number of rects[0..n) containing (col, row)
+int coverCount(const Region *rects, int n, int col, int row)
+{
+  int i, count = 0;
+  for (i = 0; i < n; i++)
+    count += contains(&rects[i], col, row);
+  return count;
+}
+
+void testIntersect()
+{
+  Region a = rect(0, 0, 9, 9), r;
+  Region touching = rect(10, 0, 19, 9), inside = rect(2, 3, 4, 5), overlap = rect(5, 5, 14, 14);
+  Region empty = rect(5, 5, 4, 4), corner = rect(5, 5, 9, 9), pixel = rect(3, 3, 3, 3);
+  Region screen = rect(0, 0, 127, 159);
+
+  regionIntersect(&r, &a, &overlap);
+  expect(!memcmp(&r, &corner, sizeof(r)), "overlap intersection");
+  regionIntersect(&r, &a, &touching);
+  expect(regionIsEmpty(&r), "touching rects intersect");
+  regionIntersect(&r, &a, &inside);
+  expect(!memcmp(&r, &inside, sizeof(r)), "contained intersection is the inner rect");
+  regionIntersect(&r, &a, &empty);
+  expect(regionIsEmpty(&r), "intersection with an empty rect");
+
+  expect(!regionIsEmpty(&pixel), "single pixel is empty");
+  expect(regionIsEmpty(&empty), "inverted rect is not empty");
+  expect(regionArea(&a) == 100, "area of 10x10 is %ld", regionArea(&a));
+  expect(regionArea(&empty) == 0, "area of empty rect is %ld", regionArea(&empty));
+  expect(regionArea(&screen) == 20480L, "screen area overflows");
+}
+
+void testSubtractCounts()
+{
+  static const struct {
+    Region r2;
+    u_char pieces;
+    const char *what;
+  } cases[] = {
+    {{{20, 20}, {30, 30}}, 1, "disjoint"},
+    {{{10, 0}, {19, 9}}, 1, "touching"},
+    {{{-5, -5}, {15, 15}}, 0, "covering"},
+    {{{0, 0}, {9, 9}}, 0, "equal"},
+    {{{3, 3}, {6, 6}}, 4, "contained"},
+    {{{5, 5}, {15, 15}}, 2, "corner"},
+    {{{-5, 5}, {15, 15}}, 1, "bottom band"},
+    {{{3, 5}, {6, 15}}, 3, "notch"},
+    {{{3, -5}, {6, 15}}, 2, "vertical slot"},
+  };
+  Region r1 = rect(0, 0, 9, 9), empty = rect(5, 5, 4, 4), pieces[4];
+  u_char i;
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    u_char n = regionSubtract(pieces, &r1, &cases[i].r2);
+    expect(n == cases[i].pieces, "subtract %s: %d pieces, expected %d",
+	   cases[i].what, n, cases[i].pieces);
+  }
+  expect(regionSubtract(pieces, &empty, &r1) == 0, "subtract from empty rect");
+}
+
+// pieces of r1 - r2 cover exactly the pixels of r1 not in r2, once each
+void testSubtractRandom()
+{
+  int t, col, row;
+  for (t = 0; t < 20000; t++) {
+    Region r1 = randRect(), r2 = randRect(), pieces[4];
+    u_char n = regionSubtract(pieces, &r1, &r2);
+    expect(n <= 4, "subtract returned %d pieces", n);
+    for (row = -1; row <= GRID; row++)
+      for (col = -1; col <= GRID; col++) {
+	int want = contains(&r1, col, row) && !contains(&r2, col, row);
+	int got = coverCount(pieces, n, col, row);
+	if (got != want) {
+	  expect(0, "subtract covers (%d,%d) %d times, expected %d", col, row, got, want);
+	  return;
+	}
+      }
+  }
+}
+
+// random adds: the list covers their union exactly once per pixel,
+// no two rects share a whole edge, and failed adds change nothing
+void testRegionList()
+{
+  int t, k, col, row, overflows = 0;
+  for (t = 0; t < 5000; t++) {
+    RegionList list, saved;
+    u_char covered[GRID][GRID];
+    memset(covered, 0, sizeof(covered));
+    regionListInit(&list);
+    for (k = 0; k < 12; k++) {
+      Region r = randRect();
+      u_char i, j;
+      saved = list;
+      if (!regionListAdd(&list, &r)) {
+	overflows++;
+	expect(list.numRects == saved.numRects &&
+	       !memcmp(list.rects, saved.rects, saved.numRects * sizeof(Region)),
+	       "failed add changed the list");
+	continue;
+      }
+      for (row = r.topLeft.axes[1]; row <= r.botRight.axes[1]; row++)
+	for (col = r.topLeft.axes[0]; col <= r.botRight.axes[0]; col++)
+	  covered[row][col] = 1;
+      for (row = 0; row < GRID; row++)
+	for (col = 0; col < GRID; col++)
+	  if (coverCount(list.rects, list.numRects, col, row) != covered[row][col]) {
+	    expect(0, "list covers (%d,%d) %d times, expected %d", col, row,
+		   coverCount(list.rects, list.numRects, col, row), covered[row][col]);
+	    return;
+	  }
+      for (i = 0; i < list.numRects; i++)
+	for (j = i + 1; j < list.numRects; j++) {
+	  const Region *a = &list.rects[i], *b = &list.rects[j];
+	  int sameCols = a->topLeft.axes[0] == b->topLeft.axes[0] && a->botRight.axes[0] == b->botRight.axes[0];
+	  int sameRows = a->topLeft.axes[1] == b->topLeft.axes[1] && a->botRight.axes[1] == b->botRight.axes[1];
+	  expect(!(sameCols && (a->botRight.axes[1] + 1 == b->topLeft.axes[1] ||
+				b->botRight.axes[1] + 1 == a->topLeft.axes[1])) &&
+		 !(sameRows && (a->botRight.axes[0] + 1 == b->topLeft.axes[0] ||
+				b->botRight.axes[0] + 1 == a->topLeft.axes[0])),
+		 "rects sharing an edge were not coalesced");
+	}
+    }
+  }
+  expect(overflows > 0, "no add overflowed the list; overflow is untested");
+}
+
+// random invalidations, in cells of 4x4 pixels so that rects are big
+// enough to be worth keeping apart: a DirtyList's rects are pairwise
+// disjoint, fit DIRTY_MAX, and cover every pixel added
+void testDirtyList()
+{
+  int t, k, col, row;
+  long kept = 0;
+  for (t = 0; t < 5000; t++) {
+    DirtyList d;
+    u_char covered[GRID][GRID];
+    memset(covered, 0, sizeof(covered));
+    dirtyInit(&d);
+    for (k = 0; k < 12; k++) {
+      Region cells = randRect(), r;
+      u_char i, j;
+      r = rect(cells.topLeft.axes[0] * 4, cells.topLeft.axes[1] * 4,
+	       cells.botRight.axes[0] * 4 + 3, cells.botRight.axes[1] * 4 + 3);
+      dirtyAdd(&d, &r);
+      for (row = cells.topLeft.axes[1]; row <= cells.botRight.axes[1]; row++)
+	for (col = cells.topLeft.axes[0]; col <= cells.botRight.axes[0]; col++)
+	  covered[row][col] = 1;
+      expect(d.numRects <= DIRTY_MAX, "%d rects in a DirtyList", d.numRects);
+      for (i = 0; i < d.numRects; i++)
+	for (j = i + 1; j < d.numRects; j++) {
+	  Region inter;
+	  regionIntersect(&inter, &d.rects[i], &d.rects[j]);
+	  expect(regionIsEmpty(&inter), "DirtyList rects %d and %d overlap", i, j);
+	}
+      for (row = 0; row < GRID * 4; row++)
+	for (col = 0; col < GRID * 4; col++)
+	  if (covered[row / 4][col / 4] && !coverCount(d.rects, d.numRects, col, row)) {
+	    expect(0, "DirtyList misses (%d,%d)", col, row);
+	    return;
+	  }
+    }
+    kept += d.numRects;
+  }
+  expect(kept > 5000, "DirtyLists kept one rect at most; subtraction is untested");
+}
+
+// time loops of each operation (ns per call on this host)
+void benchmark()
+{
+  enum { N = 200000 };
+  static Region rects[256];
+  Region r, pieces[4];
+  long i, n = 0;
+  clock_t start;
+  for (i = 0; i < 256; i++)
+    rects[i] = randRect();
+
+  start = clock();
+  for (i = 0; i < N; i++)
+    regionIntersect(&r, &rects[i & 255], &rects[(i + 1) & 255]);
+  printf("regionTest: regionIntersect %6.1f ns\n", (clock() - start) * 1e9 / CLOCKS_PER_SEC / N);
+
+  start = clock();
+  for (i = 0; i < N; i++)
+    n += regionSubtract(pieces, &rects[i & 255], &rects[(i + 1) & 255]);
+  printf("regionTest: regionSubtract  %6.1f ns (%.2f pieces)\n",
+	 (clock() - start) * 1e9 / CLOCKS_PER_SEC / N, (double)n / N);
+
+  start = clock();
+  for (i = 0; i < N; i += 4) {
+    RegionList list;
+    regionListInit(&list);
+    regionListAdd(&list, &rects[i & 255]);
+    regionListAdd(&list, &rects[(i + 1) & 255]);
+    regionListAdd(&list, &rects[(i + 2) & 255]);
+    regionListAdd(&list, &rects[(i + 3) & 255]);
+  }
+  printf("regionTest: regionListAdd   %6.1f ns\n", (clock() - start) * 1e9 / CLOCKS_PER_SEC / N);
+}
+
+int main()
+{
+  srand(34);
+  testIntersect();
+  testSubtractCounts();
+  testSubtractRandom();
+  testRegionList();
+  testDirtyList();
+  benchmark();
+  printf("regionTest: %d failures\n", failures);
+  return failures != 0;
+}
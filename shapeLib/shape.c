@@ -22,3 +22,83 @@ abShapeCheck(const AbShape *s, const Vec2 *centerPos, const Vec2 *pixelLoc)
   return (*s->check)(s, centerPos, pixelLoc);
 }
 
+
+/* Span functions of the shapes in this library and circleLib.  The
+ * references are weak so that a shape is only linked into programs
+ * that use it; entries for unlinked shapes are null.
+ */
+typedef int (*AbCheckFn)(const AbShape *, const Vec2 *, const Vec2 *);
+typedef int (*AbSpansFn)(const AbShape *, const Vec2 *, int, Span *);
+
+#pragma weak abRectCheck
+#pragma weak abRectGetSpans
+#pragma weak abRectOutlineCheck
+#pragma weak abRectOutlineGetSpans
+#pragma weak abRArrowCheck
+#pragma weak abRArrowGetSpans
+#pragma weak abPolygonCheck
+#pragma weak abPolygonGetSpans
+#pragma weak abPatternCheck
+#pragma weak abPatternGetSpans
+#pragma weak abCompositeCheck
+#pragma weak abCompositeGetSpans
+#pragma weak abBitmapCheck
+#pragma weak abBitmapGetSpans
+#pragma weak abTextCheck
+#pragma weak abTextGetSpans
+int abCircleCheck(const AbShape *, const Vec2 *, const Vec2 *) __attribute__((weak));
+int abCircleGetSpans(const AbShape *, const Vec2 *, int, Span *) __attribute__((weak));
+
+/* indexed by ABSHAPE_ type - 1 */
+static const struct {
+  AbCheckFn check;
+  AbSpansFn getSpans;
+} libSpanClasses[] = {
+  {(AbCheckFn)abRectCheck, (AbSpansFn)abRectGetSpans},
+  {(AbCheckFn)abRectOutlineCheck, (AbSpansFn)abRectOutlineGetSpans},
+  {(AbCheckFn)abRArrowCheck, (AbSpansFn)abRArrowGetSpans},
+  {(AbCheckFn)abCircleCheck, (AbSpansFn)abCircleGetSpans},
+  {(AbCheckFn)abPolygonCheck, (AbSpansFn)abPolygonGetSpans},
+  {(AbCheckFn)abPatternCheck, (AbSpansFn)abPatternGetSpans},
+  {(AbCheckFn)abCompositeCheck, (AbSpansFn)abCompositeGetSpans},
+  {(AbCheckFn)abBitmapCheck, (AbSpansFn)abBitmapGetSpans},
+  {(AbCheckFn)abTextCheck, (AbSpansFn)abTextGetSpans},
+};
+
+static AbSpanClass *spanClasses = 0; /* registered by programs */
+
+void
+abShapeAddSpanClass(AbSpanClass *spanClass)
+{
+  spanClass->next = spanClasses;
+  spanClasses = spanClass;
+}
+
+int
+abShapeTypeGetSpans(u_char shapeType, const AbShape *s, const Vec2 *centerPos, int row,
+		    Span *spans)
+{
+  AbSpanClass *c;
+  if (shapeType != ABSHAPE_OTHER) /* no search */
+    return libSpanClasses[shapeType - 1].getSpans(s, centerPos, row, spans);
+  for (c = spanClasses; c; c = c->next)
+    if (c->check == (AbCheckFn)s->check)
+      return c->getSpans(s, centerPos, row, spans);
+  return -1;
+}
+
+int
+abShapeGetSpans(const AbShape *s, const Vec2 *centerPos, int row, Span *spans)
+{
+  return abShapeTypeGetSpans(abShapeType(s), s, centerPos, row, spans);
+}
+
+u_char
+abShapeType(const AbShape *s)
+{
+  u_char i;
+  for (i = 0; i < sizeof(libSpanClasses) / sizeof(libSpanClasses[0]); i++)
+    if (libSpanClasses[i].check == (AbCheckFn)s->check)
+      return i + 1;
+  return ABSHAPE_OTHER;
+}
@@ -6,6 +6,7 @@
 #define shape_included
 
 #include "lcdutils.h"
+#include "lcddraw.h"
 
 /** Vec2 contain a position or vector
  *
@@ -48,20 +49,118 @@ void vec2Sub(Vec2 *result, const Vec2 *a1, const Vec2 *a2);
  */ 
 void vec2Abs(Vec2 *vec);
 
+/** Fixed-point position or velocity in 1/FIX_ONE pixel units (Q12.4).
+ *
+ *  Twelve integer bits hold screen coordinates with room for
+ *  off-screen positions; a velocity of 1 moves a pixel every 16 ticks.
+ */
+typedef struct {
+  int axes[2];
+} Vec2Fix;
+
+#define FIX_SHIFT 4
+#define FIX_ONE (1 << FIX_SHIFT)
+#define FIX(pixels) ((pixels) * FIX_ONE) /**< whole pixels to fixed point */
+
+/** Advance pos by vel: pos += vel */
+static inline void
+vec2FixStep(Vec2Fix *pos, const Vec2Fix *vel)
+{
+  pos->axes[0] += vel->axes[0];
+  pos->axes[1] += vel->axes[1];
+}
+
+/** Quantize a fixed-point position to whole pixels (rounding down) */
+static inline void
+vec2FixToPixels(Vec2 *pixels, const Vec2Fix *fix)
+{
+  pixels->axes[0] = fix->axes[0] >> FIX_SHIFT;
+  pixels->axes[1] = fix->axes[1] >> FIX_SHIFT;
+}
+
+/** Convert a whole-pixel position to fixed point */
+static inline void
+vec2FixFromPixels(Vec2Fix *fix, const Vec2 *pixels)
+{
+  fix->axes[0] = FIX(pixels->axes[0]);
+  fix->axes[1] = FIX(pixels->axes[1]);
+}
+
 /** Specifies a rectangular region
  */
 typedef struct {
   Vec2 topLeft, botRight;	/* in screen coordinates */
 } Region;		
 
+/** A horizontal run of pixels from colMin to colMax (inclusive) within a row
+ */
+typedef struct {
+  int colMin, colMax;
+} Span;
+
+/** Most spans a shape reports for one row */
+#define SPANS_MAX 8
+
 /** Computes the bounding box containing two regions.
  */
 void regionUnion(Region *rUnion, const Region *r1, const Region *r2);
 
-/** Clip region within screen bounds
+/** Computes the intersection of two regions, which is empty
+ *  (see regionIsEmpty) if they don't overlap.
+ */
+void regionIntersect(Region *rInter, const Region *r1, const Region *r2);
+
+/** Nonzero if region r contains no pixels.
+ */
+int regionIsEmpty(const Region *r);
+
+/** Number of pixels in region r.
+ */
+long regionArea(const Region *r);
+
+/** Computes r1 minus r2 as at most four disjoint rectangles: the bands
+ *  above and below r2, then the strips to its left and right.
+ *
+ *  \param pieces (out) the rectangles
+ *  \return the number of rectangles
+ */
+u_char regionSubtract(Region pieces[4], const Region *r1, const Region *r2);
+
+/** Clip region within screen bounds (0..screenWidth-1, 0..screenHeight-1)
  */
 void regionClipScreen(Region *region);
 
+/** Add the pixels of r not already in rects[0..*numRects), which are
+ *  disjoint, as more disjoint rectangles (regionListAdd without joining
+ *  them).  rects[*numRects..maxRects) is used while working.
+ *
+ *  \return 0 (leaving *numRects unchanged) if more than maxRects
+ *  rectangles are needed
+ */
+int regionsAdd(Region *rects, u_char *numRects, u_char maxRects, const Region *r);
+
+/** Most rectangles in a RegionList */
+#ifndef REGION_LIST_MAX
+#define REGION_LIST_MAX 8
+#endif
+
+/** A set of pixels, as disjoint rectangles.
+ */
+typedef struct {
+  Region rects[REGION_LIST_MAX];
+  u_char numRects;
+} RegionList;
+
+/** Empty list. */
+void regionListInit(RegionList *list);
+
+/** Add the pixels of r to list.  Only the parts of r not already in
+ *  the list are added, and rectangles sharing a whole edge are joined.
+ *
+ *  \return 0 (leaving list unchanged) if there are too many rectangles
+ */
+int regionListAdd(RegionList *list, const Region *r);
+
 /** This function initializes the screen
  *  vectors that are used by shapes
  *
@@ -85,6 +184,39 @@ typedef struct AbShape_s {		/* base type for all abstrct shapes */
   int (*check)(const struct AbShape_s *shape, const Vec2 *centerPos, const Vec2 *pixelLoc);
 } AbShape;
 
+/** Optional row-span query for a class of AbShapes
+ *
+ *  AbShapes are identified by their check function, so existing
+ *  AbShape structs (and their initializers) need no new fields.
+ *
+ *  check: the check function shared by the class's AbShapes
+ *
+ *  getSpans: writes the spans of row covered by shape rendered at
+ *  centerPos (at most SPANS_MAX, left to right) and returns how many,
+ *  or -1 if they don't fit (the caller then checks each pixel).
+ */
+typedef struct AbSpanClass_s {
+  int (*check)(const AbShape *shape, const Vec2 *centerPos, const Vec2 *pixelLoc);
+  int (*getSpans)(const AbShape *shape, const Vec2 *centerPos, int row, Span *spans);
+  struct AbSpanClass_s *next;
+} AbSpanClass;
+
+/** Register the span function of an AbShape class not in this library.
+ *  Classes that are not registered are rendered by checking pixels.
+ */
+void abShapeAddSpanClass(AbSpanClass *spanClass);
+
+/** Compute the spans of row covered by an AbShape
+ *
+ *  \param shape (in) The abstract shape
+ *  \param centerPos (in) The center position of the shape
+ *  \param row (in) The row
+ *  \param spans (out) At most SPANS_MAX spans, left to right
+ *  \return Number of spans, or -1 if the shape's class has no span
+ *  function or they don't fit
+ */
+int abShapeGetSpans(const AbShape *shape, const Vec2 *centerPos, int row, Span *spans);
+
 /** Computes bounding box of abShape in screen coordinates 
  *
  *  \param s (in) The abstract shape
@@ -121,6 +253,10 @@ void abRArrowGetBounds(const AbRArrow *arrow, const Vec2 *centerPos, Region *bou
  */
 int abRArrowCheck(const AbRArrow *arrow, const Vec2 *centerPos, const Vec2 *pixel);
 
+/** Span function (see AbSpanClass)
+ */
+int abRArrowGetSpans(const AbRArrow *arrow, const Vec2 *centerPos, int row, Span *spans);
+
 /** AbShape rectangle
  *
  *  Vector halfSize must be to first quadrant (both axes non-negative).  
@@ -140,6 +276,10 @@ void abRectGetBounds(const AbRect *rect, const Vec2 *centerPos, Region *bounds);
  */
 int abRectCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel);
 
+/** Span function (see AbSpanClass)
+ */
+int abRectGetSpans(const AbRect *rect, const Vec2 *centerPos, int row, Span *spans);
+
 typedef AbRect AbRectOutline;	/* same as AbRect */
 
 /** As required by AbShape
@@ -150,6 +290,302 @@ void abRectOutlineGetBounds(const AbRect *rect, const Vec2 *centerPos, Region *b
  */
 int abRectOutlineCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel);
 
+/** Span function (see AbSpanClass)
+ */
+int abRectOutlineGetSpans(const AbRect *rect, const Vec2 *centerPos, int row, Span *spans);
+
+/** AbShape convex polygon (includes triangles)
+ *
+ *  verts are relative to centerPos and listed in order around the
+ *  perimeter (either direction).  Renders the same pixels as lcdLib's
+ *  fillConvexPolygon.
+ *
+ *  Like fillConvexPolygon, rows are found by walking the edges down
+ *  with an integer DDA (divides only when starting an edge, no
+ *  multiplies).  The walk of the last polygon queried is kept (54 bytes
+ *  of RAM), so rows asked for in order cost a few adds each.  It is
+ *  restarted when asked for a row above it or when the verts it depends
+ *  on have changed, so verts may be edited in place; a query that
+ *  interrupts another (from an interrupt handler) walks from the top on
+ *  its own stack.
+ */
+typedef struct AbPolygon_s {
+  void (*getBounds)(const struct AbPolygon_s *poly, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbPolygon_s *poly, const Vec2 *centerPos, const Vec2 *pixel);
+  const Vec2 *verts;
+  u_char numVerts;
+} AbPolygon;
+
+/** As required by AbShape
+ */
+void abPolygonGetBounds(const AbPolygon *poly, const Vec2 *centerPos, Region *bounds);
+
+/** As required by AbShape
+ */
+int abPolygonCheck(const AbPolygon *poly, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Compute the part of row covered by the polygon centered at centerPos
+ *
+ *  \return True (1) if row intersects the polygon; span is then set
+ */
+int abPolygonGetSpan(const AbPolygon *poly, const Vec2 *centerPos, int row, Span *span);
+
+/** Span function (see AbSpanClass)
+ */
+int abPolygonGetSpans(const AbPolygon *poly, const Vec2 *centerPos, int row, Span *spans);
+
+/** AbShape rectangle filled with a repeating lcdLib Pattern
+ *
+ *  Runs whose color is gapColor are not part of the shape, so lower
+ *  layers show through them; other runs are rendered in the layer's
+ *  color.  The pattern's origin is the rectangle's top-left corner
+ *  plus phase, so scrolling stripes only requires changing phase (with
+ *  abPatternSetPhase).  Rows are located with adds, shifts and
+ *  subtracts, not divides.
+ */
+typedef struct AbPattern_s {
+  void (*getBounds)(const struct AbPattern_s *pat, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbPattern_s *pat, const Vec2 *centerPos, const Vec2 *pixel);
+  Vec2 halfSize;
+  const Pattern *pattern;
+  u_int gapColor;
+  Vec2 phase;			/* non-negative: see abPatternSetPhase */
+} AbPattern;
+
+/** Set pat's phase, normalized to within the pattern's width and
+ *  height, so it may be negative or keep growing as the pattern scrolls.
+ *
+ *  \return 0 (leaving phase unchanged) if pat's pattern can't be drawn
+ *          or is too wide (see patternWidth)
+ */
+int abPatternSetPhase(AbPattern *pat, int colPhase, int rowPhase);
+
+/** As required by AbShape
+ */
+void abPatternGetBounds(const AbPattern *pat, const Vec2 *centerPos, Region *bounds);
+
+/** As required by AbShape
+ */
+int abPatternCheck(const AbPattern *pat, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Compute the spans of row covered by the pattern
+ *
+ *  \param spans (out) at most SPANS_MAX spans, left to right
+ *  \return Number of spans, or -1 if the row needs more than SPANS_MAX
+ */
+int abPatternGetSpans(const AbPattern *pat, const Vec2 *centerPos, int row, Span *spans);
+
+/** AbShape drawn from a 1-bit-per-pixel mask (see makeBitmap)
+ *
+ *  Row r of the mask is the 1 << rowShift bytes at bits + (r << rowShift),
+ *  leftmost pixel in the msb.  colFirst[r] and colLast[r] are the first
+ *  and last set columns of row r (colFirst > colLast if none), so most
+ *  pixels outside the shape are rejected without reading the mask.  The
+ *  mask is centered on the shape's position.
+ */
+typedef struct AbBitmap_s {
+  void (*getBounds)(const struct AbBitmap_s *bitmap, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbBitmap_s *bitmap, const Vec2 *centerPos, const Vec2 *pixel);
+  u_char width, height;		/* at most 128 */
+  u_char rowShift;
+  const u_char *bits;
+  const u_char *colFirst, *colLast;
+} AbBitmap;
+
+/** As required by AbShape
+ */
+void abBitmapGetBounds(const AbBitmap *bitmap, const Vec2 *centerPos, Region *bounds);
+
+/** As required by AbShape
+ */
+int abBitmapCheck(const AbBitmap *bitmap, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Span function (see AbSpanClass): the runs of set pixels in row
+ */
+int abBitmapGetSpans(const AbBitmap *bitmap, const Vec2 *centerPos, int row, Span *spans);
+
+/** AbShape of a string's set pixels in a (possibly subsetted) 5x7 font
+ *
+ *  As with drawStringFont5x7, each character is 5 columns by 8 rows.
+ *  The first length characters of string are centered on the shape's
+ *  position; change string's characters freely, but invalidate the
+ *  layer's bounds (e.g. with dirtyAdd) to have them redrawn.  Only the
+ *  glyphs' set pixels are part of the shape, so layers below show
+ *  between them.
+ */
+typedef struct AbText_s {
+  void (*getBounds)(const struct AbText_s *text, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbText_s *text, const Vec2 *centerPos, const Vec2 *pixel);
+  const Font5x7 *font;
+  u_char length;		/* characters drawn */
+  const char *string;
+} AbText;
+
+/** As required by AbShape
+ */
+void abTextGetBounds(const AbText *text, const Vec2 *centerPos, Region *bounds);
+
+/** As required by AbShape
+ */
+int abTextCheck(const AbText *text, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Span function (see AbSpanClass)
+ */
+int abTextGetSpans(const AbText *text, const Vec2 *centerPos, int row, Span *spans);
+
+/** A part of an AbComposite: a shape centered at offset from the
+ *  composite's center.  bounds and shapeType are set by abCompositeInit().
+ */
+typedef struct {
+  const AbShape *shape;
+  Vec2 offset;
+  Region bounds;		/* relative to the composite's center */
+  u_char shapeType;
+} AbPart;
+
+#define AB_UNION 0		/**< pixels in any part */
+#define AB_INTERSECT 1		/**< pixels in every part */
+#define AB_DIFFERENCE 2		/**< pixels in the first part but no other */
+
+/** AbShape combining the shapes of several parts, so that (for example)
+ *  a car's body and wheels can be one layer.
+ *
+ *  Each part's bounds are checked before its shape, and rectangle parts
+ *  need no other check.  Call abCompositeInit() before use.
+ */
+typedef struct AbComposite_s {
+  void (*getBounds)(const struct AbComposite_s *comp, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbComposite_s *comp, const Vec2 *centerPos, const Vec2 *pixel);
+  u_char op;			/* AB_UNION, AB_INTERSECT or AB_DIFFERENCE */
+  u_char numParts;
+  AbPart *parts;
+} AbComposite;
+
+/** Compute the bounds (and types) of comp's parts, including those of
+ *  composite parts.  Call again after changing a part's offset or shape.
+ *  Parts are measured centered on the screen, so shapes whose getBounds
+ *  clip to the screen (such as AbCircle) must fit within it from there.
+ */
+void abCompositeInit(AbComposite *comp);
+
+/** As required by AbShape: the union or intersection of the parts'
+ *  bounds, or the first part's bounds for AB_DIFFERENCE
+ */
+void abCompositeGetBounds(const AbComposite *comp, const Vec2 *centerPos, Region *bounds);
+
+/** As required by AbShape
+ */
+int abCompositeCheck(const AbComposite *comp, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Span function (see AbSpanClass): combines the parts' spans.
+ *  Returns -1 if a part has no span function or the row needs more than
+ *  SPANS_MAX spans.
+ */
+int abCompositeGetSpans(const AbComposite *comp, const Vec2 *centerPos, int row, Span *spans);
+
+/** AbShape circle (functions are in circleLib's abCircle.h)
+ *  
+ *  chords should be a vector of length radius + 1.  
+ *  Entry at index i is 1/2 chord length at distance i from the circle's center.  
+ *  This vector can be generated using lcdLib's computeChordVec() (lcddraw.h).
+ */ 
+typedef struct AbCircle_s {
+  void (*getBounds)(const struct AbCircle_s *circle, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbCircle_s *circle, const Vec2 *centerPos, const Vec2 *pixel);
+  const u_char *chords;
+  const u_char radius;
+} AbCircle;
+
+/** Types of the shapes in this library and circleLib (see
+ *  abShapeType).  The renderers cache a shape's type, check the first
+ *  four without calling through its check pointer, and find the spans
+ *  of all of them without a search (see abShapeTypeGetSpans).
+ */
+#define ABSHAPE_OTHER 0		/**< call check */
+#define ABSHAPE_RECT 1
+#define ABSHAPE_RECT_OUTLINE 2
+#define ABSHAPE_RARROW 3
+#define ABSHAPE_CIRCLE 4
+#define ABSHAPE_POLYGON 5
+#define ABSHAPE_PATTERN 6
+#define ABSHAPE_COMPOSITE 7
+#define ABSHAPE_BITMAP 8
+#define ABSHAPE_TEXT 9
+
+/** Identify a built-in shape by its check function.
+ *
+ *  \return an ABSHAPE_ type, ABSHAPE_OTHER for other shapes
+ */
+u_char abShapeType(const AbShape *s);
+
+/** abShapeGetSpans for a shape whose type is known: a built-in
+ *  shape's span function is found by indexing, and only shapes of
+ *  ABSHAPE_OTHER search the registered AbSpanClasses.
+ *
+ *  \param shapeType abShapeType(shape)
+ */
+int abShapeTypeGetSpans(u_char shapeType, const AbShape *shape, const Vec2 *centerPos,
+			int row, Span *spans);
+
+/** Nonzero to store layer positions and bounds in bytes: sizeof(Layer)
+ *  is then 20 rather than 30 bytes on the MSP430, and bounds are
+ *  compared a byte at a time.  Set it with -DLAYER_COORD8=1 (the
+ *  Makefiles' LAYER_COORD8 variable), alike for the libraries and the
+ *  programs linked with them.  Positions must then be within
+ *  -POS8_BIAS .. 255-POS8_BIAS, and are read and written with
+ *  layerPosGet/layerPosSet (or LAYER_POS in initializers), which work
+ *  either way.
+ */
+#ifndef LAYER_COORD8
+#define LAYER_COORD8 0
+#endif
+
+#if LAYER_COORD8
+#define POS8_BIAS 64
+/** A layer position: screen coordinate + POS8_BIAS in each byte */
+typedef struct {
+  u_char axes[2];
+} LayerPos;
+/** A layer's bounds, clipped to the screen */
+typedef struct {
+  struct { u_char axes[2]; } topLeft, botRight;
+} LayerBounds;
+#define LAYER_POS(col, row) {(col) + POS8_BIAS, (row) + POS8_BIAS}
+#define layerPosAxis(p, axis) ((int)(p).axes[axis] - POS8_BIAS)
+#define layerPosAxisSet(p, axis, val) ((p).axes[axis] = (val) + POS8_BIAS)
+/** An on-screen coordinate, as compared with LayerBounds */
+#define layerCoord(v) ((u_char)(v))
+/** True if on-screen coordinate v is within lo..hi (one axis of a
+ *  LayerBounds): a single unsigned compare, of bytes
+ */
+#define layerBoundsIn(v, lo, hi) ((u_char)((v) - (lo)) <= (u_char)((hi) - (lo)))
+#else
+typedef Vec2 LayerPos;
+typedef Region LayerBounds;
+#define LAYER_POS(col, row) {col, row}
+#define layerPosAxis(p, axis) ((p).axes[axis])
+#define layerPosAxisSet(p, axis, val) ((p).axes[axis] = (val))
+#define layerCoord(v) (v)
+#define layerBoundsIn(v, lo, hi) ((u_int)((v) - (lo)) <= (u_int)((hi) - (lo)))
+#endif
+
+
+/** Read a layer position into v */
+static inline void
+layerPosGet(const LayerPos *p, Vec2 *v)
+{
+  v->axes[0] = layerPosAxis(*p, 0);
+  v->axes[1] = layerPosAxis(*p, 1);
+}
+
+/** Set a layer position from v */
+static inline void
+layerPosSet(LayerPos *p, const Vec2 *v)
+{
+  layerPosAxisSet(*p, 0, v->axes[0]);
+  layerPosAxisSet(*p, 1, v->axes[1]);
+}
+
 /** Linked list of Layers.  
  * 
  *  Each layer contains
@@ -157,28 +593,439 @@ int abRectOutlineCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pi
  *   - the layer's current position
  *   - the layer's color
  *   - a reference to the next (lower) layer.
+ *   - the shape's bounding box at pos, cached by layerUpdateBounds()
+ *   - flags (LAYER_STATIC, LAYER_OPAQUE, LAYER_HIDDEN)
+ *   - the shape's ABSHAPE_ type, cached by layerUpdateBounds()
+ *   - a reference to the previous (higher) layer, set by layerInit()
  */
 typedef struct Layer_s {
   AbShape *abShape;
-  Vec2 pos, posLast, posNext; /* initially just set pos */
+  LayerPos pos, posLast, posNext; /* initially just set pos */
   u_int color;
   struct Layer_s *next;
+  LayerBounds bounds;		/* set by layerInit() & layerUpdateBounds() */
+  u_char flags;			/* LAYER_STATIC, LAYER_OPAQUE, LAYER_HIDDEN */
+  u_char shapeType;		/* set by layerInit() & layerUpdateBounds() */
+  struct Layer_s *prev;		/* set by layerInit() & the LayerList functions */
 } Layer;	
 
+/** Layer flag: the layer never moves or changes, and lies behind all
+ *  layers without this flag.  When bgCache is set, such layers are drawn
+ *  from it rather than composited.
+ */
+#define LAYER_STATIC 1
+
+/** Layer flag: the layer's shape fills its bounds.  Its shapeType is
+ *  then ABSHAPE_RECT (as for AbRect layers, which need not be flagged),
+ *  so the renderers treat its bounds as covering: the pixels it covers
+ *  are filled as one run without probing it or the layers below, and
+ *  layers below one that covers a whole drawn area are skipped.
+ */
+#define LAYER_OPAQUE 2
+
+/** Layer flag: the layer is not drawn.  The renderers test it before
+ *  anything else, so a hidden layer costs no probes (see layerSetHidden).
+ */
+#define LAYER_HIDDEN 4
+
+/** Nonzero if l->pos differs from l->posLast */
+static inline int
+layerMoved(const Layer *l)
+{
+  return layerPosAxis(l->pos, 0) != layerPosAxis(l->posLast, 0) ||
+    layerPosAxis(l->pos, 1) != layerPosAxis(l->posLast, 1);
+}
+
+/** Read l->bounds into r */
+static inline void
+layerBoundsGet(const Layer *l, Region *r)
+{
+  r->topLeft.axes[0] = l->bounds.topLeft.axes[0];
+  r->topLeft.axes[1] = l->bounds.topLeft.axes[1];
+  r->botRight.axes[0] = l->bounds.botRight.axes[0];
+  r->botRight.axes[1] = l->bounds.botRight.axes[1];
+}
+
+/** Recompute l->bounds (and l->shapeType).  Required whenever l->pos,
+ *  l->abShape or l->flags changes.
+ */
+void layerUpdateBounds(Layer *l);
+
+/** Check if pixel is within layer l's shape.
+ *
+ *  pixel must be on the screen.  Pixels outside l->bounds are rejected
+ *  by two unsigned compares (see layerBoundsIn).
+ *  The built-in shapes (l->shapeType) are then checked inline; only
+ *  other shapes are checked by calling through their check pointer.
+ */
+static inline int
+layerCheck(const Layer *l, const Vec2 *pixel)
+{
+  const LayerBounds *b = &l->bounds;
+  int col, row;
+  if (!layerBoundsIn(pixel->axes[0], b->topLeft.axes[0], b->botRight.axes[0]) ||
+      !layerBoundsIn(pixel->axes[1], b->topLeft.axes[1], b->botRight.axes[1]))
+    return 0;
+  col = pixel->axes[0] - layerPosAxis(l->pos, 0);
+  row = pixel->axes[1] - layerPosAxis(l->pos, 1);
+  switch (l->shapeType) {
+  case ABSHAPE_RECT:		/* fills its bounds */
+    return 1;
+  case ABSHAPE_RECT_OUTLINE: {	/* as abRectOutlineCheck; bounds limit col & row */
+    const Vec2 *halfSize = &((const AbRectOutline *)l->abShape)->halfSize;
+    return col == halfSize->axes[0] || col == -halfSize->axes[0] ||
+      row == halfSize->axes[1] || row == -halfSize->axes[1];
+  }
+  case ABSHAPE_RARROW: {	/* as abRArrowCheck; bounds limit col & row */
+    int halfSize = ((const AbRArrow *)l->abShape)->size / 2;
+    col = -col;
+    row = (row >= 0) ? row : -row;
+    return (col <= halfSize) ? row <= col : row <= halfSize / 2;
+  }
+  case ABSHAPE_CIRCLE:		/* as abCircleCheck; bounds limit col */
+    col = (col >= 0) ? col : -col;
+    row = (row >= 0) ? row : -row;
+    return ((const AbCircle *)l->abShape)->chords[col] >= row;
+  default: {
+    Vec2 pos;
+    layerPosGet(&l->pos, &pos);
+    return abShapeCheck(l->abShape, &pos, pixel);
+  }
+  }
+}
+
 /** Compute layer's bounding box.
  */
 void layerGetBounds(const Layer *l, Region *bounds);
 
+/** Compute the parts of layer's bounds at posLast that are outside its
+ *  current bounds (l->bounds), as at most four rectangles (not clipped
+ *  to the screen).  Redrawing these and l->bounds repaints every pixel
+ *  that changed when the layer moved.
+ *
+ *  \param exposed (out) the exposed rectangles
+ *  \return the number of rectangles
+ */
+u_char layerGetExposed(const Layer *l, Region exposed[4]);
+
 /**
-  sets bounds into a consistent state
+  sets bounds into a consistent state (including each layer's cached bounds
+  and prev link)
  */
 void layerInit(Layer *layers);
 
-/** Render all layers.   
+/** Render all layers (within layerClip).   
  *  Pixels that are not contained by a layer are set to bgColor.
  */
 void layerDraw(Layer *layers);
 
+/** A full-screen redraw done a band of rows at a time (see
+ *  layerRedrawStep), so no one call composites the whole screen.
+ *  Zero-initialized, no redraw is in progress.
+ */
+typedef struct {
+  u_char rowsLeft;		/**< rows still to draw; the next is screenHeight - rowsLeft */
+} LayerRedraw;
+
+/** Start (or restart from the top) a full-screen redraw. */
+void layerRedrawStart(LayerRedraw *redraw);
+
+/** Render the next band of at most rows rows of redraw from layers
+ *  (within layerClip), then advance its cursor.  Call once per frame,
+ *  choosing rows to fit the frame's time budget; layers may move in
+ *  between, as long as the rows already drawn are repainted (e.g. by a
+ *  DirtyList).
+ *
+ *  \return the rows left to draw (0 once the screen is done)
+ */
+u_char layerRedrawStep(LayerRedraw *redraw, Layer *layers, u_char rows);
+
+/** Most clips layerClipPush() saves. */
+#ifndef LAYER_CLIP_DEPTH
+#define LAYER_CLIP_DEPTH 1
+#endif
+
+/** The renderers only draw within this region (initially the screen),
+ *  and dirtyAdd() clips to it.  Change it with layerClipPush() and
+ *  layerClipPop(), e.g. to render a HUD band and the playfield below it
+ *  independently.
+ */
+extern Region layerClip;
+
+/** Save layerClip, then narrow it to its intersection with r.
+ *
+ *  \return 0 (leaving layerClip unchanged) if LAYER_CLIP_DEPTH clips
+ *  are already saved
+ */
+int layerClipPush(const Region *r);
+
+/** Restore the layerClip saved by the last layerClipPush(). */
+void layerClipPop(void);
+
+/** Pixels the renderers composite before sending them to the LCD in
+ *  one burst (lcd_writeColors), at most screenWidth.  The buffer is a
+ *  single static of 2 bytes per pixel (the renderers don't nest, so
+ *  don't draw from interrupt handlers); 0 sends pixels one at a time.
+ */
+#ifndef LINE_BUF_PIXELS
+#define LINE_BUF_PIXELS 8
+#endif
+
+/** Most single-color runs the renderers merge in a row, 4 bytes of
+ *  stack each.  Rows with more are composited pixel by pixel.
+ */
+#ifndef ROW_RUNS_MAX
+#define ROW_RUNS_MAX 8
+#endif
+
+/** Most layers the renderers cull by row, 3 bytes of stack each (at
+ *  most 16).  Longer lists are rendered without culling.
+ */
+#ifndef LAYERS_MAX
+#define LAYERS_MAX 8
+#endif
+
+/** Nonzero to count the renderers' shape probes in layerStats. */
+#ifndef LAYER_STATS
+#define LAYER_STATS 0
+#endif
+
+#if LAYER_STATS
+/** Renderer counters (zero them to start measuring) */
+typedef struct {
+  unsigned long probes;		/**< pixels checked against a layer's shape */
+  unsigned long probesElided;	/**< checks skipped as covered by opaque layers */
+} LayerStats;
+
+extern LayerStats layerStats;
+#endif
+
+/** Render the layers within area and layerClip.
+ *
+ *  Layers whose bounds miss the clipped area are dropped before any
+ *  row is composited.  Each row is composited from the layers' spans (see AbSpanClass)
+ *  into single-color runs, so shapes are only checked pixel by pixel
+ *  when their class has no span function.  Only layers whose bounds
+ *  include the row are consulted, and none below an opaque layer
+ *  (see LAYER_OPAQUE) whose bounds include area.
+ */
+void layerDrawRegion(Layer *layers, const Region *area);
+
+/** Render area from an array of at most LAYERS_MAX layers (top first),
+ *  ignoring their next pointers.  Used to draw part of the screen that
+ *  only some layers overlap (see TileBins).
+ */
+void layerDrawArray(Layer *const layers[], u_char numLayers, const Region *area);
+
+#ifndef BG_RUNS_MAX
+#define BG_RUNS_MAX 6		/**< most runs in a BgCache */
+#endif
+#ifndef BG_BANDS_MAX
+#define BG_BANDS_MAX 2		/**< most bands in a BgCache */
+#endif
+
+/** A run of background color, from the previous run's colMax + 1 */
+typedef struct {
+  u_char colMax;
+  u_int color;
+} BgRun;
+
+/** Consecutive rows with the same background runs */
+typedef struct {
+  u_char rowMax;		/**< last row of the band */
+  u_char firstRun;		/**< index of its first run */
+} BgBand;
+
+/** The static layers precomposited with bgColor, run-length encoded.
+ *  Each band's runs cover the screen's width; the bands cover its height.
+ */
+typedef struct {
+  BgRun runs[BG_RUNS_MAX];
+  BgBand bands[BG_BANDS_MAX];
+  u_char numRuns, numBands;
+} BgCache;
+
+/** Composite the layers flagged LAYER_STATIC (whose bounds must be
+ *  current) over bgColor into cache.  Rebuild it if they or bgColor
+ *  change.
+ *
+ *  \return 0 if the background needs more than BG_RUNS_MAX runs or
+ *  BG_BANDS_MAX bands (cache is left empty and must not be used)
+ */
+int bgCacheBuild(BgCache *cache, Layer *layers);
+
+/** When set, layerDrawRegion skips LAYER_STATIC layers and fills pixels
+ *  not covered by other layers from this cache instead of bgColor.
+ */
+extern const BgCache *bgCache;
+
+/** Most rectangles a DirtyList holds.  Adding to a full list merges. */
+#ifndef DIRTY_MAX
+#define DIRTY_MAX 4
+#endif
+
+/** Cost of rendering one more rectangle (lcd_setArea and compositor
+ *  setup), in pixels.  Two rectangles are merged when their bounding
+ *  box wastes no more pixels than this.
+ */
+#ifndef DIRTY_RECT_COST
+#define DIRTY_RECT_COST 48
+#endif
+
+/** Regions of the screen invalidated during a frame.
+ *
+ *  Overlapping and nearby regions are merged as they are added, and
+ *  the rectangles kept are disjoint, so that each pixel is composited
+ *  and sent only once.
+ */
+typedef struct {
+  Region rects[DIRTY_MAX];
+  u_char numRects;
+} DirtyList;
+
+/** Empty d. */
+void dirtyInit(DirtyList *d);
+
+/** Invalidate r (clipped to layerClip), merging it with d's rectangles
+ *  while a merge costs fewer pixels than DIRTY_RECT_COST.  Then only
+ *  the parts of it they don't cover are kept (see regionsAdd).  While
+ *  those don't fit, the cheapest pair of d's rectangles and r is
+ *  merged, along with any rectangles their union overlaps.
+ */
+void dirtyAdd(DirtyList *d, const Region *r);
+
+/** Invalidate what changed when layer l moved from posLast to pos:
+ *  its current bounds plus the parts of its old bounds they don't cover
+ *  (see layerGetExposed), rather than the box around both.  The cost
+ *  model merges these back together when the move is small.
+ */
+void dirtyAddLayer(DirtyList *d, const Layer *l);
+
+/** Render each of d's rectangles once with layerDrawRegion, then empty d. */
+void dirtyDraw(DirtyList *d, Layer *layers);
+
+/** Moving Layer
+ *  Linked list of layer references
+ *  Velocity represents one iteration of change (direction & magnitude)
+ *  in 1/FIX_ONE pixels; posFix tracks layer->posNext to that precision.
+ */
+typedef struct MovLayer_s {
+  Layer *layer;
+  Vec2Fix velocity;
+  struct MovLayer_s *next;
+  Vec2Fix posFix;		/**< set by movLayerInit() */
+} MovLayer;
+
+/** Told about each layer that movLayerUpdate() moved (arg is passed through) */
+typedef void (*MovLayerHook)(void *arg, const Layer *l);
+
+/** Start each moving layer's posFix at its layer's posNext. */
+void movLayerInit(MovLayer *movLayers);
+
+/** Bumped by movLayerPublish(); read by movLayerUpdate(). */
+extern volatile u_int movLayerSeq;
+
+/** Publish a complete frame of posNext values.  Call after writing them
+ *  (typically at the end of the interrupt handler that advances layers).
+ */
+static inline void
+movLayerPublish(void)
+{
+  __asm__ __volatile__("" ::: "memory"); /* posNext stores come first */
+  movLayerSeq++;
+}
+
+/** Move each layer to posNext, then update the bounds of those whose
+ *  pixel position changed and pass them to hook.
+ *
+ *  Interrupts stay enabled: if a handler publishes while posNext is
+ *  being copied, the copy is repeated, so pos is always one complete
+ *  published frame.  Should handlers keep publishing mid-copy, the
+ *  whole frame is copied in one window with interrupts disabled, so
+ *  the copy always completes.
+ */
+void movLayerUpdate(MovLayer *movLayers, MovLayerHook hook, void *arg);
+
+/** MovLayerHook that invalidates l in the DirtyList dirty (dirtyAddLayer). */
+void movLayerDirty(void *dirty, const Layer *l);
+
+/** movLayerUpdate() into a DirtyList, then redraw it from layers. */
+void movLayerDraw(MovLayer *movLayers, Layer *layers);
+
+/** A layer list whose layers can be added, removed and restacked while
+ *  it is drawn.  Render it from top.  Each change below invalidates the
+ *  affected layer's bounds (at pos and posLast, see layerGetBounds) in
+ *  dirty so that area is repainted once by dirtyDraw; dirty may be 0 if
+ *  the caller redraws the screen.  Layers are unlinked and relinked in
+ *  constant time using their prev links; inserting at depth z walks z
+ *  layers.  Rebuild any BgCache or TileBins made from the list after
+ *  changing it.
+ */
+typedef struct {
+  Layer *top;
+} LayerList;
+
+/** Adopt a chain of layers linked by their next pointers (as by static
+ *  initializers), calling layerInit() on it.
+ */
+void layerListInit(LayerList *list, Layer *top);
+
+/** Insert l (not in any list) below the top z layers, or at the bottom
+ *  if the list has fewer.  Its posLast, posNext and bounds are set as by
+ *  layerInit().
+ */
+void layerListInsert(LayerList *list, Layer *l, u_char z, DirtyList *dirty);
+
+/** Remove l from list, invalidating the area it was drawn in. */
+void layerListRemove(LayerList *list, Layer *l, DirtyList *dirty);
+
+/** Move l to the top of list. */
+void layerListToFront(LayerList *list, Layer *l, DirtyList *dirty);
+
+/** Hide (hidden nonzero) or show l, which stays in its list. */
+void layerSetHidden(Layer *l, u_char hidden, DirtyList *dirty);
+
+#ifndef TILE_SIZE
+#define TILE_SIZE 16		/**< tile width & height (pixels) */
+#endif
+#ifndef TILE_LAYERS_MAX
+#define TILE_LAYERS_MAX 2	/**< bytes (layers) per tile */
+#endif
+#define TILE_COLS ((screenWidth + TILE_SIZE - 1) / TILE_SIZE)
+#define TILE_ROWS ((screenHeight + TILE_SIZE - 1) / TILE_SIZE)
+#define TILE_NONE 0xff		/**< unused tile slot */
+#define TILE_MANY 0xfe		/**< first slot: too many layers for the tile */
+
+/** The screen divided into tiles, each listing the layers whose bounds
+ *  overlap it (as indices into the layer list, top first), and the
+ *  tiles that need redrawing.
+ *
+ *  The default 16x16 tiles with two layers each take 170 bytes.
+ */
+typedef struct {
+  u_char tiles[TILE_ROWS][TILE_COLS][TILE_LAYERS_MAX];
+  u_char dirty[(TILE_ROWS * TILE_COLS + 7) / 8];
+} TileBins;
+
+/** Bin each layer into the tiles its bounds (which must be current)
+ *  overlap.  Tiles overlapped by more than TILE_LAYERS_MAX layers are
+ *  marked TILE_MANY.  Call whenever layers move.
+ */
+void tileBin(TileBins *bins, Layer *layers);
+
+/** Mark the tiles overlapping r for redrawing. */
+void tileInvalidate(TileBins *bins, const Region *r);
+
+/** Mark every tile for redrawing. */
+void tileInvalidateAll(TileBins *bins);
+
+/** Redraw the marked tiles within layerClip.  Each is rendered from its
+ *  own layers, TILE_MANY tiles from the whole list, and runs of empty
+ *  tiles are filled with bgColor.  Tiles not wholly within layerClip
+ *  stay marked.
+ */
+void tileDraw(TileBins *bins, Layer *layers);
+
 /** Background color.
   */
 extern u_int bgColor;		/*  background color */
@@ -0,0 +1,82 @@
+#include "shape.h"
+
+#define TEXT_CHAR_COLS 5
+#define TEXT_ROWS 8
+
+/* the glyph of string's i'th character */
+static const u_char *
+abTextGlyph(const AbText *text, u_char i)
+{
+  u_char oc = text->string[i] - 0x20;
+  return text->font->glyphs[text->font->map ? text->font->map[oc] : oc];
+}
+
+/** GetBounds function required by AbShape
+ */
+void
+abTextGetBounds(const AbText *text, const Vec2 *centerPos, Region *bounds)
+{
+  int width = (text->length << 2) + text->length; /* TEXT_CHAR_COLS each */
+  bounds->topLeft.axes[0] = centerPos->axes[0] - (width >> 1);
+  bounds->topLeft.axes[1] = centerPos->axes[1] - (TEXT_ROWS >> 1);
+  bounds->botRight.axes[0] = bounds->topLeft.axes[0] + width - 1;
+  bounds->botRight.axes[1] = bounds->topLeft.axes[1] + TEXT_ROWS - 1;
+}
+
+/** Check function required by AbShape
+ *  Rows and columns outside the text are huge when unsigned.
+ */
+int
+abTextCheck(const AbText *text, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  Region bounds;
+  u_int row, col;
+  u_char i = 0;
+  abTextGetBounds(text, centerPos, &bounds);
+  row = pixel->axes[1] - bounds.topLeft.axes[1];
+  col = pixel->axes[0] - bounds.topLeft.axes[0];
+  if (row >= TEXT_ROWS || col > (u_int)(bounds.botRight.axes[0] - bounds.topLeft.axes[0]))
+    return 0;
+  while (col >= 4 * TEXT_CHAR_COLS) { /* no divide: skip 4 characters at a time */
+    col -= 4 * TEXT_CHAR_COLS;
+    i += 4;
+  }
+  while (col >= TEXT_CHAR_COLS) {
+    col -= TEXT_CHAR_COLS;
+    i++;
+  }
+  return abTextGlyph(text, i)[col] & (1 << row);
+}
+
+/** Span function (see AbSpanClass)
+ *  Runs of set pixels may continue from one character into the next.
+ */
+int
+abTextGetSpans(const AbText *text, const Vec2 *centerPos, int row, Span *spans)
+{
+  Region bounds;
+  u_char i, c, bit;
+  int col, numSpans = 0, inSpan = 0;
+  abTextGetBounds(text, centerPos, &bounds);
+  if (row < bounds.topLeft.axes[1] || row > bounds.botRight.axes[1])
+    return 0;
+  bit = 1 << (row - bounds.topLeft.axes[1]);
+  col = bounds.topLeft.axes[0];
+  for (i = 0; i < text->length; i++) {
+    const u_char *glyph = abTextGlyph(text, i);
+    for (c = 0; c < TEXT_CHAR_COLS; c++, col++) {
+      if (!(glyph[c] & bit)) {
+	inSpan = 0;
+      } else if (inSpan) {
+	spans[numSpans - 1].colMax = col;
+      } else {
+	if (numSpans == SPANS_MAX)
+	  return -1;		/* too many: caller must probe pixels */
+	spans[numSpans].colMin = spans[numSpans].colMax = col;
+	numSpans++;
+	inSpan = 1;
+      }
+    }
+  }
+  return numSpans;
+}
@@ -0,0 +1,140 @@
+#include "shape.h"
+
+/* add layer index i to tile t */
+static void
+tileAdd(u_char *t, u_char i)
+{
+  u_char slot;
+  if (t[0] == TILE_MANY)
+    return;
+  for (slot = 0; slot < TILE_LAYERS_MAX && t[slot] != TILE_NONE; slot++)
+    ;
+  if (slot == TILE_LAYERS_MAX || i >= TILE_MANY)
+    t[0] = TILE_MANY;		/* over budget: draw from whole list */
+  else
+    t[slot] = i;
+}
+
+/* tiles overlapping r (clipped to the screen); returns 0 if none */
+static int
+tileRange(const Region *r, u_char *colMin, u_char *rowMin, u_char *colMax, u_char *rowMax)
+{
+  Region clipped = *r;
+  regionClipScreen(&clipped);
+  if (regionIsEmpty(&clipped))
+    return 0;
+  *colMin = clipped.topLeft.axes[0] / TILE_SIZE;
+  *rowMin = clipped.topLeft.axes[1] / TILE_SIZE;
+  *colMax = clipped.botRight.axes[0] / TILE_SIZE;
+  *rowMax = clipped.botRight.axes[1] / TILE_SIZE;
+  return 1;
+}
+
+void
+tileBin(TileBins *bins, Layer *layers)
+{
+  u_char i, tc, tr, colMin, rowMin, colMax, rowMax;
+  Region bounds;
+  for (tr = 0; tr < TILE_ROWS; tr++)
+    for (tc = 0; tc < TILE_COLS; tc++)
+      for (i = 0; i < TILE_LAYERS_MAX; i++)
+	bins->tiles[tr][tc][i] = TILE_NONE;
+  for (i = 0; layers; layers = layers->next, i += (i < TILE_MANY)) {
+    if ((layers->flags & LAYER_HIDDEN) || (bgCache && (layers->flags & LAYER_STATIC)))
+      continue;			/* hidden, or drawn from bgCache */
+    layerBoundsGet(layers, &bounds);
+    if (!tileRange(&bounds, &colMin, &rowMin, &colMax, &rowMax))
+      continue;
+    for (tr = rowMin; tr <= rowMax; tr++)
+      for (tc = colMin; tc <= colMax; tc++)
+	tileAdd(bins->tiles[tr][tc], i);
+  }
+}
+
+void
+tileInvalidate(TileBins *bins, const Region *r)
+{
+  u_char tc, tr, colMin, rowMin, colMax, rowMax;
+  if (!tileRange(r, &colMin, &rowMin, &colMax, &rowMax))
+    return;
+  for (tr = rowMin; tr <= rowMax; tr++)
+    for (tc = colMin; tc <= colMax; tc++) {
+      u_int n = tr * TILE_COLS + tc;
+      bins->dirty[n >> 3] |= 1 << (n & 7);
+    }
+}
+
+void
+tileInvalidateAll(TileBins *bins)
+{
+  u_char i;
+  for (i = 0; i < sizeof(bins->dirty); i++)
+    bins->dirty[i] = 0xff;
+}
+
+/* tile (tc, tr)'s pixels on the screen */
+static void
+tileRegion(Region *r, u_char tc, u_char tr)
+{
+  r->topLeft.axes[0] = tc * TILE_SIZE;
+  r->topLeft.axes[1] = tr * TILE_SIZE;
+  r->botRight.axes[0] = r->topLeft.axes[0] + TILE_SIZE - 1;
+  r->botRight.axes[1] = r->topLeft.axes[1] + TILE_SIZE - 1;
+  regionClipScreen(r);
+}
+
+/* true if r lies within layerClip */
+static int
+tileInClip(const Region *r)
+{
+  return r->topLeft.axes[0] >= layerClip.topLeft.axes[0] &&
+    r->topLeft.axes[1] >= layerClip.topLeft.axes[1] &&
+    r->botRight.axes[0] <= layerClip.botRight.axes[0] &&
+    r->botRight.axes[1] <= layerClip.botRight.axes[1];
+}
+
+void
+tileDraw(TileBins *bins, Layer *layers)
+{
+  u_char tc, tr;
+  for (tr = 0; tr < TILE_ROWS; tr++) {
+    for (tc = 0; tc < TILE_COLS; tc++) {
+      u_int n = tr * TILE_COLS + tc;
+      u_char *t = bins->tiles[tr][tc];
+      Region area, tile;
+      if (!(bins->dirty[n >> 3] & (1 << (n & 7))))
+	continue;
+      tileRegion(&tile, tc, tr);
+      regionIntersect(&area, &tile, &layerClip);
+      if (regionIsEmpty(&area))
+	continue;		/* outside the clip: stays marked */
+      if (tileInClip(&tile))
+	bins->dirty[n >> 3] &= ~(1 << (n & 7));
+      if (t[0] == TILE_NONE && !bgCache) { /* empty: one background run */
+	while (tc + 1 < TILE_COLS && bins->tiles[tr][tc+1][0] == TILE_NONE &&
+	       (bins->dirty[(n+1) >> 3] & (1 << ((n+1) & 7)))) {
+	  tileRegion(&tile, tc + 1, tr);
+	  if (!tileInClip(&tile))
+	    break;
+	  tc++; n++;		/* and the empty dirty tiles to its right */
+	  bins->dirty[n >> 3] &= ~(1 << (n & 7));
+	  area.botRight.axes[0] = tile.botRight.axes[0];
+	}
+	fillRectangle(area.topLeft.axes[0], area.topLeft.axes[1],
+		      area.botRight.axes[0] - area.topLeft.axes[0] + 1,
+		      area.botRight.axes[1] - area.topLeft.axes[1] + 1, bgColor);
+      } else if (t[0] == TILE_MANY) {
+	layerDrawRegion(layers, &area);
+      } else {			/* just the tile's layers */
+	Layer *tileLayers[TILE_LAYERS_MAX], *l = layers;
+	u_char i, slot, numLayers = 0;
+	for (slot = 0, i = 0; slot < TILE_LAYERS_MAX && t[slot] != TILE_NONE; slot++) {
+	  for (; i < t[slot]; i++)
+	    l = l->next;
+	  tileLayers[numLayers++] = l;
+	}
+	layerDrawArray(tileLayers, numLayers, &area);
+      }
+    }
+  }
+}
@@ -0,0 +1,78 @@
+/** \file vec2inline.h
+ *  \brief Inline Vec2 and Region arithmetic for hot paths.
+ *
+ *  Each function here computes the same result as its namesake without
+ *  "Inline" (vec2Add, regionUnion ...), which remain linkable for other
+ *  code.  These avoid a call and the two-iteration axis loop.
+ */
+
+#ifndef vec2inline_included
+#define vec2inline_included
+
+#include "shape.h"
+
+/** vec2Max, inline */
+static inline void
+vec2MaxInline(Vec2 *vecMax, const Vec2 *v1, const Vec2 *v2)
+{
+  vecMax->axes[0] = v1->axes[0] > v2->axes[0] ? v1->axes[0] : v2->axes[0];
+  vecMax->axes[1] = v1->axes[1] > v2->axes[1] ? v1->axes[1] : v2->axes[1];
+}
+
+/** vec2Min, inline */
+static inline void
+vec2MinInline(Vec2 *vecMin, const Vec2 *v1, const Vec2 *v2)
+{
+  vecMin->axes[0] = v1->axes[0] < v2->axes[0] ? v1->axes[0] : v2->axes[0];
+  vecMin->axes[1] = v1->axes[1] < v2->axes[1] ? v1->axes[1] : v2->axes[1];
+}
+
+/** vec2Add, inline */
+static inline void
+vec2AddInline(Vec2 *result, const Vec2 *v1, const Vec2 *v2)
+{
+  result->axes[0] = v1->axes[0] + v2->axes[0];
+  result->axes[1] = v1->axes[1] + v2->axes[1];
+}
+
+/** vec2Sub, inline */
+static inline void
+vec2SubInline(Vec2 *result, const Vec2 *v1, const Vec2 *v2)
+{
+  result->axes[0] = v1->axes[0] - v2->axes[0];
+  result->axes[1] = v1->axes[1] - v2->axes[1];
+}
+
+/** vec2Abs, inline */
+static inline void
+vec2AbsInline(Vec2 *vec)
+{
+  if (vec->axes[0] < 0) vec->axes[0] = -vec->axes[0];
+  if (vec->axes[1] < 0) vec->axes[1] = -vec->axes[1];
+}
+
+/** regionUnion, inline */
+static inline void
+regionUnionInline(Region *rUnion, const Region *r1, const Region *r2)
+{
+  vec2MinInline(&rUnion->topLeft, &r1->topLeft, &r2->topLeft);
+  vec2MaxInline(&rUnion->botRight, &r1->botRight, &r2->botRight);
+}
+
+/** regionIntersect, inline */
+static inline void
+regionIntersectInline(Region *rInter, const Region *r1, const Region *r2)
+{
+  vec2MaxInline(&rInter->topLeft, &r1->topLeft, &r2->topLeft);
+  vec2MinInline(&rInter->botRight, &r1->botRight, &r2->botRight);
+}
+
+/** regionIsEmpty, inline */
+static inline int
+regionIsEmptyInline(const Region *r)
+{
+  return r->botRight.axes[0] < r->topLeft.axes[0] ||
+    r->botRight.axes[1] < r->topLeft.axes[1];
+}
+
+#endif // included
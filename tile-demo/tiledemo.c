@@ -0,0 +1,160 @@
+/** \file tiledemo.c
+ *  \brief Tile-binned renderer demo and benchmark.
+ *
+ *  Bounces 3 to NUM_SHAPES small shapes around the screen, drawing
+ *  each frame first with a DirtyList and then with TileBins.  After
+ *  FRAMES frames of each, the watchdog ticks (about 244 per second)
+ *  they took are shown:
+ *
+ *    n  dirty  tiles
+ *
+ *  Each shape takes RAM for its Layer and velocity, so the msp430g2553
+ *  only has room for a few (see Makefile).
+ */
+#include <msp430.h>
+#include <libTimer.h>
+#include <lcdutils.h>
+#include <lcddraw.h>
+#include <shape.h>
+
+#define GREEN_LED BIT6
+
+#ifndef NUM_SHAPES
+#define NUM_SHAPES 3
+#endif
+#define FRAMES 50
+
+AbRect rect3 = {abRectGetBounds, abRectCheck, {3,3}}; /**< 7x7 square */
+AbRArrow arrow8 = {abRArrowGetBounds, abRArrowCheck, 8};
+
+const u_int colors[] = {COLOR_RED, COLOR_YELLOW, COLOR_GREEN, COLOR_WHITE};
+const u_char shapeCounts[] = {3, 5, 10, 20, 40}; /**< benchmark steps */
+
+Layer shapes[NUM_SHAPES];
+Vec2 velocity[NUM_SHAPES];
+TileBins bins;
+
+u_int bgColor = COLOR_BLUE;     /**< The background color */
+int redrawScreen = 0;           /**< never wakes the CPU from the WDT handler */
+volatile u_int ticks;		/**< watchdog interrupts so far */
+
+/** Scatter the first n shapes and draw them */
+void shapesInit(u_char n)
+{
+  u_char i;
+  for (i = 0; i < n; i++) {
+    Layer *l = &shapes[i];
+    l->abShape = (i & 1) ? (AbShape *)&arrow8 : (AbShape *)&rect3;
+    layerPosAxisSet(l->pos, 0, 10 + (i * 37) % (screenWidth - 20));
+    layerPosAxisSet(l->pos, 1, 10 + (i * 53) % (screenHeight - 20));
+    l->color = colors[i & 3];
+    l->next = (i + 1 < n) ? &shapes[i+1] : 0;
+    velocity[i].axes[0] = (i & 1) ? -(1 + i % 3) : 1 + i % 3;
+    velocity[i].axes[1] = (i & 2) ? 1 : -2;
+  }
+  layerInit(shapes);
+  layerDraw(shapes);
+}
+
+/** Move each of the first n shapes, bouncing off the screen's edges */
+void shapesAdvance(u_char n)
+{
+  u_char i, axis;
+  for (i = 0; i < n; i++) {
+    Layer *l = &shapes[i];
+    l->posLast = l->pos;
+    for (axis = 0; axis < 2; axis++) {
+      int pos = layerPosAxis(l->pos, axis) + velocity[i].axes[axis];
+      if (pos < 10 || pos > screenSize.axes[axis] - 11) { /* shapes reach 8 from pos */
+	velocity[i].axes[axis] = -velocity[i].axes[axis];
+	pos += 2 * velocity[i].axes[axis];
+      }
+      layerPosAxisSet(l->pos, axis, pos);
+    }
+    layerUpdateBounds(l);
+  }
+}
+
+/** Ticks taken to animate n shapes for FRAMES frames, using tiles or a DirtyList */
+u_int bench(u_char n, u_char useTiles)
+{
+  u_int start;
+  u_char frame, i;
+  shapesInit(n);
+  tileBin(&bins, shapes);
+  start = ticks;
+  for (frame = 0; frame < FRAMES; frame++) {
+    DirtyList dirty;
+    dirtyInit(&dirty);
+    shapesAdvance(n);
+    for (i = 0; i < n; i++) {
+      if (useTiles) {
+	Region bounds;
+	layerGetBounds(&shapes[i], &bounds);
+	tileInvalidate(&bins, &bounds);
+      } else
+	dirtyAddLayer(&dirty, &shapes[i]);
+    }
+    if (useTiles) {
+      tileBin(&bins, shapes);
+      tileDraw(&bins, shapes);
+    } else
+      dirtyDraw(&dirty, shapes);
+  }
+  return ticks - start;
+}
+
+/** Format val right-justified in width characters */
+void formatNum(char *s, u_int val, u_char width)
+{
+  s[width] = 0;
+  do {
+    s[--width] = '0' + val % 10;
+    val /= 10;
+  } while (val && width);
+  while (width)
+    s[--width] = ' ';
+}
+
+void main()
+{
+  u_int results[sizeof(shapeCounts)][2];
+  u_char step, numSteps = 0;
+  P1DIR |= GREEN_LED;		/**< Green led on while benchmarking */
+  P1OUT |= GREEN_LED;
+
+  configureClocks();
+  lcd_init();
+
+  enableWDTInterrupts();      /**< enable periodic interrupt */
+  or_sr(0x8);	              /**< GIE (enable interrupts) */
+
+  for (step = 0; step < sizeof(shapeCounts) && shapeCounts[step] <= NUM_SHAPES; step++) {
+    results[step][0] = bench(shapeCounts[step], 0);
+    results[step][1] = bench(shapeCounts[step], 1);
+    numSteps = step + 1;
+  }
+
+  clearScreen(COLOR_BLUE);
+  drawString5x7(10, 10, " n dirty tiles", COLOR_WHITE, COLOR_BLUE);
+  for (step = 0; step < numSteps; step++) {
+    char num[6];
+    u_char row = 22 + step * 10;
+    formatNum(num, shapeCounts[step], 2);
+    drawString5x7(10, row, num, COLOR_WHITE, COLOR_BLUE);
+    formatNum(num, results[step][0], 5);
+    drawString5x7(28, row, num, COLOR_WHITE, COLOR_BLUE);
+    formatNum(num, results[step][1], 5);
+    drawString5x7(64, row, num, COLOR_WHITE, COLOR_BLUE);
+  }
+
+  P1OUT &= ~GREEN_LED;
+  for (;;)
+    or_sr(0x10);		/**< CPU OFF */
+}
+
+/** Watchdog timer interrupt handler: counts ticks */
+void wdt_c_handler()
+{
+  ticks++;
+}
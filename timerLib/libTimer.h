@@ -5,7 +5,7 @@ void configureClocks();
 void enableWDTInterrupts();
 void timerAUpmode();
 
-unsigned char gert_sr();
+unsigned char get_sr();
 void set_sr(), or_sr(), and_sr();
 
 #endif // included